@@ -3,7 +3,7 @@
 // -----------------------------------------------------------------------------
 // Title       : A RISC-V processor
 // Project     : Algol
-// Description : A multi-cycle, RV32I, RISC-V processor.
+// Description : A multi-cycle, RV32I[M][A][C], RISC-V processor.
 // -----------------------------------------------------------------------------
 
 `default_nettype none
@@ -21,11 +21,24 @@
 `endif
 
 module algol #(
-               parameter [31:0] HART_ID         = 0,
-               parameter [31:0] RESET_ADDR      = 32'h8000_0000,
-               parameter        FAST_SHIFT      = 0,
-               parameter        ENABLE_RV32M    = 0,
-               parameter        ENABLE_COUNTERS = 0
+               parameter [31:0] HART_ID            = 0,
+               parameter [31:0] RESET_ADDR         = 32'h8000_0000,
+               parameter        FAST_SHIFT         = 0,
+               parameter        SHIFT_STEP         = 1,
+               parameter        ENABLE_RV32M       = 0,
+               parameter        ENABLE_RV32A       = 0,
+               parameter        ENABLE_RV32C       = 0,
+               parameter        ENABLE_ZB          = 0,
+               parameter        MULT_LATENCY       = 3,
+               parameter        DIV_RADIX          = 2,
+               parameter        ENABLE_COUNTERS    = 0,
+               parameter        ENABLE_PREFETCH    = 0,
+               parameter        ENABLE_HARVARD     = 0,
+               parameter        ENABLE_VECTORED    = 0,
+               parameter        HPM_COUNTERS       = 0,
+               parameter        ENABLE_SHADOW_REGS = 0,
+               parameter        ENABLE_MISALIGNED  = 0,
+               parameter        ENABLE_CFU         = 0
                )(
                  input wire        clk,
                  input wire        rst,
@@ -37,10 +50,34 @@ module algol #(
                  input wire [31:0] mem_rdata,
                  input wire        mem_ready,
                  input wire        mem_error,
+                 // Memory port: sideband signals for caches and the bus
+                 output reg        mem_fetch,
+                 output wire       mem_fencei,
+                 output wire       mem_fence,
+                 input wire        mem_fence_wait,
+                 output wire       mem_lock,
+                 // writes of other bus masters: clear the LR reservation (RV32A)
+                 input wire        snoop_valid,
+                 input wire [31:0] snoop_address,
+                 // Instruction port (ENABLE_HARVARD)
+                 output reg [31:0] imem_address,
+                 output reg        imem_valid,
+                 input wire [31:0] imem_rdata,
+                 input wire        imem_ready,
+                 input wire        imem_error,
+                 // Custom functional unit (ENABLE_CFU)
+                 output reg        cfu_valid,
+                 output reg [10:0] cfu_funct,
+                 output reg [31:0] cfu_op1,
+                 output reg [31:0] cfu_op2,
+                 input wire [31:0] cfu_result,
+                 input wire        cfu_ready,
                  // external interrupts interface
                  input wire        xint_meip,
                  input wire        xint_mtip,
-                 input wire        xint_msip
+                 input wire        xint_msip,
+                 // platform timer (mtime), read by the time CSR
+                 input wire [63:0] xtime
                  );
     // =====================================================================
     // CSR list
@@ -61,6 +98,19 @@ module algol #(
     localparam MINSTRET   = 12'hB02; //
     localparam MCYCLEH    = 12'hB80; //
     localparam MINSTRETH  = 12'hB82; //
+    // Performance monitoring (ENABLE_COUNTERS): mhpmcounter3-31, mhpmevent3-31,
+    // and the read-only shadows cycle, time, instret and hpmcounter3-31.
+    localparam MCOUNTINHIBIT = 12'h320; //
+    localparam MHPMEVENT3    = 12'h323; // to 0x33F
+    localparam MHPMCOUNTER3  = 12'hB03; // to 0xB1F
+    localparam MHPMCOUNTER3H = 12'hB83; // to 0xB9F
+    localparam CYCLE         = 12'hC00; // to 0xC1F: time, instret, hpmcounter3-31
+    localparam CYCLEH        = 12'hC80; // to 0xC9F
+    // Custom: register bank control (ENABLE_SHADOW_REGS)
+    localparam MSHADOW       = 12'h7C0; //
+    // verilator lint_off WIDTH
+    localparam [31:0] MCOUNTINHIBIT_MASK = ((64'b1 << (HPM_COUNTERS + 3)) - 1) & ~64'b10;
+    // verilator lint_on WIDTH
     // Exception codes
     localparam E_INST_ADDR_MISALIGNED      = 4'd0;
     localparam E_INST_ACCESS_FAULT         = 4'd1;
@@ -83,19 +133,29 @@ module algol #(
     localparam I_S_EXTERNAL                = 4'd9;
     localparam I_M_EXTERNAL                = 4'd11;
     // State machine
-    localparam cpu_state_reset   = 6'b000000;
-    localparam cpu_state_fetch   = 6'b000001;
-    localparam cpu_state_execute = 6'b000010;
-    localparam cpu_state_mem     = 6'b000100;
-    localparam cpu_state_csr     = 6'b001000;
-    localparam cpu_state_wb      = 6'b010000;
-    localparam cpu_state_trap    = 6'b100000;
+    localparam cpu_state_reset   = 4'b0000;
+    localparam cpu_state_fetch   = 4'b0001;
+    localparam cpu_state_execute = 4'b0010;
+    localparam cpu_state_mem     = 4'b0100;
+    localparam cpu_state_trap    = 4'b1000;
+    // Register file: two banks with ENABLE_SHADOW_REGS
+    localparam RF_SIZE = ENABLE_SHADOW_REGS ? 64 : 32;
     // =====================================================================
     // Signals
-    reg [5:0]   cpu_state, cpu_state_nxt;
-    reg [31:0]  pc, pc4;
+    reg [3:0]   cpu_state, cpu_state_nxt;
+    reg [31:0]  pc, pc_seq, pc_nxt;
     reg [31:0]  instruction;
     wire [31:0] instruction_q;
+    reg         inst_c;         // compressed instruction
+    reg [15:0]  instruction_c;  // compressed instruction, before expansion
+    wire        inst_c_q;
+    wire [15:0] instruction_cq;
+    wire        fetch_ready, fetch_error, fetch_bus;
+    wire [31:0] fetch_address;
+    reg [31:0]  if_address;
+    reg         if_valid;
+    wire [31:0] if_rdata;
+    wire        if_ready, if_error;
     reg         inst_lui, inst_auipc;
     reg         inst_jal, inst_jalr;
     reg         inst_beq, inst_bne, inst_blt, inst_bge, inst_bltu, inst_bgeu;
@@ -107,22 +167,29 @@ module algol #(
     reg         inst_csrrw, inst_csrrs, inst_csrrc, inst_csrrwi, inst_csrrsi, inst_csrrci;
     reg         inst_xcall, inst_xbreak, inst_xret;
     reg         inst_wfi;
+    reg         inst_cfu;
+    reg         inst_lr, inst_sc, inst_amo;
     reg         inst_mul, inst_mulh, inst_mulhsu, inst_mulhu, inst_div, inst_divu, inst_rem, inst_remu;
+    reg         inst_sh1add, inst_sh2add, inst_sh3add;
+    reg         inst_andn, inst_orn, inst_xnor, inst_clz, inst_ctz, inst_cpop, inst_max, inst_maxu, inst_min, inst_minu;
+    reg         inst_sextb, inst_sexth, inst_zexth, inst_rol, inst_ror, inst_rori, inst_orcb, inst_rev8;
     reg         is_j, is_b, is_l, is_s, is_shift, is_csr, is_csrx, is_csrs, is_csrc;
     reg         is_add, is_logic, is_cmp;
-    reg         is_mul, is_div;
+    reg         is_mul, is_div, is_zb, is_cfu, is_amo;
     reg [31:0]  imm_i, imm_s, imm_b, imm_u, imm_j;
     wire [4:0]  rs1, rs2, rd;
     reg [31:0]  rs1_d, rs2_d, rf_wdata;
     reg         rf_we;
-    reg [31:0]  regfile1 [0:31];
-    reg [31:0]  regfile2 [0:31];
+    reg [31:0]  regfile1 [0:RF_SIZE-1];
+    reg [31:0]  regfile2 [0:RF_SIZE-1];
+    reg         shadow_en, shadow_bank, shadow_pbank;
+    wire        rf_bank;
     reg         is_imm;
     //
     wire        interrupt;
     reg [31:0]  mem_dat_o, mem_dat_i;
     reg [3:0]   mem_sel_o;
-    reg [11:0]  csr_address;
+    wire [11:0] csr_address;
     // =====================================================================
     // debug-simulation
     `FORMAL_KEEP reg [20*8 - 1:0] dbg_ascii_state;
@@ -133,16 +200,16 @@ module algol #(
         if (cpu_state == cpu_state_fetch)   dbg_ascii_state = "fetch";
         if (cpu_state == cpu_state_execute) dbg_ascii_state = "execute";
         if (cpu_state == cpu_state_mem)     dbg_ascii_state = "mem";
-        if (cpu_state == cpu_state_csr)     dbg_ascii_state = "csr";
-        if (cpu_state == cpu_state_wb)      dbg_ascii_state = "commit";
         if (cpu_state == cpu_state_trap)    dbg_ascii_state = "trap";
     end // always @ (*)
     // =====================================================================
     // decodificar instruccion
-    assign instruction_q = mem_rdata;
+    // instruction_q: from the fetch unit. Compressed instructions are expanded.
     always @(posedge clk) begin
         if (cpu_state == cpu_state_fetch) begin
-            instruction <= instruction_q;
+            instruction   <= instruction_q;
+            inst_c        <= inst_c_q;
+            instruction_c <= instruction_cq;
             //
             inst_lui    <= instruction_q[6:0] == 7'b0110111;
             inst_auipc  <= instruction_q[6:0] == 7'b0010111;
@@ -201,6 +268,13 @@ module algol #(
             inst_xret   <= instruction_q[6:0] == 7'b1110011 && instruction_q[31:30] == 2'b0 && instruction_q[27:7] == 21'b000000100000000000000; // all xRET instrucctions are valid.
             //
             inst_wfi    <= instruction_q == 32'b00010000010100000000000001110011;
+            // custom-0 and custom-1 (R-type)
+            inst_cfu    <= ENABLE_CFU && (instruction_q[6:0] == 7'b0001011 || instruction_q[6:0] == 7'b0101011);
+            // RV32A. aq/rl are ignored: the accesses are done in order.
+            inst_lr     <= ENABLE_RV32A && instruction_q[6:0] == 7'b0101111 && instruction_q[14:12] == 3'b010 && instruction_q[31:27] == 5'b00010 && instruction_q[24:20] == 5'b0;
+            inst_sc     <= ENABLE_RV32A && instruction_q[6:0] == 7'b0101111 && instruction_q[14:12] == 3'b010 && instruction_q[31:27] == 5'b00011;
+            inst_amo    <= ENABLE_RV32A && instruction_q[6:0] == 7'b0101111 && instruction_q[14:12] == 3'b010 && (instruction_q[28:27] == 2'b00 ||
+                                                                                                                 instruction_q[31:27] == 5'b00001);
             //
             inst_mul    <= ENABLE_RV32M && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b000 && instruction_q[31:25] == 7'b0000001;
             inst_mulh   <= ENABLE_RV32M && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b001 && instruction_q[31:25] == 7'b0000001;
@@ -210,8 +284,29 @@ module algol #(
             inst_divu   <= ENABLE_RV32M && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b101 && instruction_q[31:25] == 7'b0000001;
             inst_rem    <= ENABLE_RV32M && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b110 && instruction_q[31:25] == 7'b0000001;
             inst_remu   <= ENABLE_RV32M && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b111 && instruction_q[31:25] == 7'b0000001;
+            // Zba/Zbb
+            inst_sh1add <= ENABLE_ZB && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b010 && instruction_q[31:25] == 7'b0010000;
+            inst_sh2add <= ENABLE_ZB && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b100 && instruction_q[31:25] == 7'b0010000;
+            inst_sh3add <= ENABLE_ZB && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b110 && instruction_q[31:25] == 7'b0010000;
+            inst_andn   <= ENABLE_ZB && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b111 && instruction_q[31:25] == 7'b0100000;
+            inst_orn    <= ENABLE_ZB && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b110 && instruction_q[31:25] == 7'b0100000;
+            inst_xnor   <= ENABLE_ZB && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b100 && instruction_q[31:25] == 7'b0100000;
+            inst_clz    <= ENABLE_ZB && instruction_q[6:0] == 7'b0010011 && instruction_q[14:12] == 3'b001 && instruction_q[31:20] == 12'b011000000000;
+            inst_ctz    <= ENABLE_ZB && instruction_q[6:0] == 7'b0010011 && instruction_q[14:12] == 3'b001 && instruction_q[31:20] == 12'b011000000001;
+            inst_cpop   <= ENABLE_ZB && instruction_q[6:0] == 7'b0010011 && instruction_q[14:12] == 3'b001 && instruction_q[31:20] == 12'b011000000010;
+            inst_sextb  <= ENABLE_ZB && instruction_q[6:0] == 7'b0010011 && instruction_q[14:12] == 3'b001 && instruction_q[31:20] == 12'b011000000100;
+            inst_sexth  <= ENABLE_ZB && instruction_q[6:0] == 7'b0010011 && instruction_q[14:12] == 3'b001 && instruction_q[31:20] == 12'b011000000101;
+            inst_zexth  <= ENABLE_ZB && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b100 && instruction_q[31:20] == 12'b000010000000;
+            inst_max    <= ENABLE_ZB && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b110 && instruction_q[31:25] == 7'b0000101;
+            inst_maxu   <= ENABLE_ZB && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b111 && instruction_q[31:25] == 7'b0000101;
+            inst_min    <= ENABLE_ZB && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b100 && instruction_q[31:25] == 7'b0000101;
+            inst_minu   <= ENABLE_ZB && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b101 && instruction_q[31:25] == 7'b0000101;
+            inst_rol    <= ENABLE_ZB && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b001 && instruction_q[31:25] == 7'b0110000;
+            inst_ror    <= ENABLE_ZB && instruction_q[6:0] == 7'b0110011 && instruction_q[14:12] == 3'b101 && instruction_q[31:25] == 7'b0110000;
+            inst_rori   <= ENABLE_ZB && instruction_q[6:0] == 7'b0010011 && instruction_q[14:12] == 3'b101 && instruction_q[31:25] == 7'b0110000;
+            inst_orcb   <= ENABLE_ZB && instruction_q[6:0] == 7'b0010011 && instruction_q[14:12] == 3'b101 && instruction_q[31:20] == 12'b001010000111;
+            inst_rev8   <= ENABLE_ZB && instruction_q[6:0] == 7'b0010011 && instruction_q[14:12] == 3'b101 && instruction_q[31:20] == 12'b011010011000;
             //
-            csr_address <= instruction_q[31:20];
             is_imm      <= instruction_q[6:0] == 7'b0010011;
         end // if (cpu_state == cpu_state_fetch && mem_valid)
     end
@@ -231,11 +326,11 @@ module algol #(
     always @(*) begin
         is_j     = |{inst_jal, inst_jalr};
         is_b     = |{inst_beq, inst_bne, inst_blt, inst_bltu, inst_bge, inst_bgeu};
-        is_l     = |{inst_lb, inst_lbu, inst_lh, inst_lhu, inst_lw};
+        is_l     = |{inst_lb, inst_lbu, inst_lh, inst_lhu, inst_lw, inst_lr};
         is_s     = |{inst_sb, inst_sh, inst_sw};
         is_csr   = |{inst_csrrw, inst_csrrs, inst_csrrc, inst_csrrwi, inst_csrrsi, inst_csrrci};
-        is_add   = |{inst_auipc, inst_lui, inst_add, inst_addi, inst_sub};
-        is_logic = |{inst_and, inst_andi, inst_or, inst_ori, inst_xor, inst_xori};
+        is_add   = |{inst_auipc, inst_lui, inst_add, inst_addi, inst_sub, inst_sh1add, inst_sh2add, inst_sh3add};
+        is_logic = |{inst_and, inst_andi, inst_or, inst_ori, inst_xor, inst_xori, inst_andn, inst_orn, inst_xnor};
         is_cmp   = |{inst_slt, inst_slti, inst_sltu, inst_sltiu};
         is_shift = |{inst_slli, inst_sll, inst_srli, inst_srl, inst_srai, inst_sra};
         is_csrs  = |{inst_csrrs, inst_csrrsi};
@@ -243,6 +338,10 @@ module algol #(
         is_csrx  = |{inst_csrrw, inst_csrrs, inst_csrrc};
         is_mul   = |{inst_mul, inst_mulh, inst_mulhsu, inst_mulhu};
         is_div   = |{inst_div, inst_divu, inst_rem, inst_remu};
+        is_zb    = |{inst_clz, inst_ctz, inst_cpop, inst_max, inst_maxu, inst_min, inst_minu,
+                     inst_sextb, inst_sexth, inst_zexth, inst_rol, inst_ror, inst_rori, inst_orcb, inst_rev8};
+        is_cfu   = inst_cfu;
+        is_amo   = |{inst_amo, inst_sc};
     end
     // =====================================================================
     // Instantiate
@@ -254,27 +353,31 @@ module algol #(
     generate
         if (ENABLE_RV32M) begin
             // mult unit
-            algol_multiplier mult_hw (
+            algol_multiplier #(
+                .MULT_LATENCY (MULT_LATENCY)
+            ) mult_hw (
                 .clk         (clk),
                 .rst         (rst),
                 .mult_op1    (rs1_d),
                 .mult_op2    (rs2_d),
                 .mult_cmd    (instruction[13:12]),
                 .mult_enable (is_mul & cpu_state == cpu_state_execute),
-                .mult_abort  (0),
+                .mult_abort  (cpu_state != cpu_state_execute),
                 .mult_result (mult_result),
                 .mult_ack    (mult_ack)
             );
 
             // div unit
-            algol_divider div_hw (
+            algol_divider #(
+                .DIV_RADIX  (DIV_RADIX)
+            ) div_hw (
                 .clk        (clk),
                 .rst        (rst),
                 .div_op1    (rs1_d),
                 .div_op2    (rs2_d),
                 .div_cmd    (instruction[13:12]),
                 .div_enable (is_div & cpu_state == cpu_state_execute),
-                .div_abort  (0),
+                .div_abort  (cpu_state != cpu_state_execute),
                 .div_result (div_result),
                 .div_ack    (div_ack)
             );
@@ -286,44 +389,61 @@ module algol #(
         end
     endgenerate
 
+    // Custom functional unit (ENABLE_CFU): custom-0 and custom-1 instructions.
+    // funct: {opcode[5] (custom-1), funct7, funct3}. The request is held until
+    // cfu_ready (one cycle pulse), and it is dropped without an answer only if
+    // the core takes an interrupt: the CFU must update its state in the
+    // cycle of cfu_ready.
+    always @(*) begin
+        cfu_valid = is_cfu && cpu_state == cpu_state_execute && !interrupt;
+        cfu_funct = {instruction[5], instruction[31:25], instruction[14:12]};
+        cfu_op1   = rs1_d;
+        cfu_op2   = rs2_d;
+    end
+
     // =====================================================================
     // Register file
     assign rs1 = instruction_q[19:15];
     assign rs2 = instruction_q[24:20];
     assign rd  = instruction[11:7];
+    assign rf_bank = ENABLE_SHADOW_REGS && shadow_bank;
     // split the RF to force BRAM in vivado.
+    // verilator lint_off WIDTH
     always @(posedge clk) begin
         if (cpu_state == cpu_state_fetch) begin
-            rs1_d <= (|rs1)? regfile1[rs1] : 0;
+            rs1_d <= (|rs1)? regfile1[{rf_bank, rs1}] : 0;
         end
         if (rf_we && |rd) begin
-            regfile1[rd] <= rf_wdata;
+            regfile1[{rf_bank, rd}] <= rf_wdata;
         end
     end
     always @(posedge clk) begin
         if (cpu_state == cpu_state_fetch) begin
-            rs2_d <= (|rs2)? regfile2[rs2] : 0;
+            rs2_d <= (|rs2)? regfile2[{rf_bank, rs2}] : 0;
         end
         if (rf_we && |rd) begin
-            regfile2[rd] <= rf_wdata;
+            regfile2[{rf_bank, rd}] <= rf_wdata;
         end
     end
-    //
-    reg [31:0] csr_dat;
-    always @(posedge clk) begin
-        csr_dat <= csr_dat_o;
-    end
+    // verilator lint_on WIDTH
+    // Instructions are committed in the last cycle of the execute state, or in
+    // the cycle the load/store is acknowledged.
+    wire exe_commit, mem_commit;
+    assign exe_commit = cpu_state == cpu_state_execute && cpu_state_nxt == cpu_state_fetch;
+    assign mem_commit = cpu_state == cpu_state_mem && cpu_state_nxt == cpu_state_fetch;
     always @(*) begin
         rf_we = 0;
-        if (cpu_state == cpu_state_wb) rf_we = !wb_error && |{is_j, is_l, is_csr, is_logic, is_cmp, is_shift, is_add, is_mul, is_div};
+        if (exe_commit) rf_we = |{is_j, is_csr, is_logic, is_cmp, is_shift, is_add, is_mul, is_div, is_zb, is_cfu};
+        if (mem_commit) rf_we = is_l || is_amo;
     end
 
     reg [31:0] rf_tmp1, rf_tmp2;
     always @(*) begin
         case (1'b1)
-            is_j:     begin rf_tmp1 = pc4;       end
+            is_j:     begin rf_tmp1 = pc_seq;    end
             is_l:     begin rf_tmp1 = mem_dat_i; end
-            is_csr:   begin rf_tmp1 = csr_dat;   end
+            is_amo:   begin rf_tmp1 = mem_dat_i; end
+            is_csr:   begin rf_tmp1 = csr_dat_o; end
             default:  begin rf_tmp1 = logic_out; end
         endcase
     end
@@ -333,17 +453,19 @@ module algol #(
             is_shift:  begin rf_tmp2 = shift_out;        end
             is_mul:    begin rf_tmp2 = mult_result;      end
             is_div:    begin rf_tmp2 = div_result;       end
+            is_zb:     begin rf_tmp2 = zb_out;           end
+            is_cfu:    begin rf_tmp2 = cfu_result;       end
             default:   begin rf_tmp2 = add_out;          end
         endcase
     end
     always @(*) begin
-        if (is_j || is_l || is_csr || is_logic) rf_wdata = rf_tmp1;
+        if (is_j || is_l || is_csr || is_logic || is_amo) rf_wdata = rf_tmp1;
         else rf_wdata = rf_tmp2;
     end
     // =========================================================================
     // FSM
     wire use_alu;
-    assign use_alu = is_add | is_j | is_b | is_cmp | is_logic;
+    assign use_alu = is_add | is_j | is_b | is_cmp | is_logic | is_zb;
     always @(posedge clk or posedge rst) begin
         if (rst) cpu_state <= cpu_state_reset;
         else     cpu_state <= cpu_state_nxt;
@@ -358,41 +480,40 @@ module algol #(
             end
             cpu_state_fetch: begin
                 case (1'b1)
-                    mem_ready:                cpu_state_nxt = cpu_state_execute;
-                    mem_error | if_unaligned: cpu_state_nxt = cpu_state_trap;
+                    fetch_ready:                cpu_state_nxt = cpu_state_execute;
+                    fetch_error | if_unaligned: cpu_state_nxt = cpu_state_trap;
                 endcase
             end
             cpu_state_execute: begin
                 case (1'b1)
                     is_shift: begin
-                        if (shift_done || FAST_SHIFT) cpu_state_nxt = cpu_state_wb;
+                        if (shift_done || FAST_SHIFT) cpu_state_nxt = cpu_state_fetch;
                     end
                     is_mul | is_div: begin
-                        if (mult_ack | div_ack) cpu_state_nxt = cpu_state_wb;
+                        if (mult_ack | div_ack) cpu_state_nxt = cpu_state_fetch;
+                    end
+                    is_cfu: begin
+                        if (cfu_ready) cpu_state_nxt = cpu_state_fetch;
+                    end
+                    use_alu:      cpu_state_nxt = target_unaligned ? cpu_state_trap : cpu_state_fetch;
+                    inst_fence: begin
+                        if (!mem_fence_wait) cpu_state_nxt = cpu_state_fetch;
                     end
-                    use_alu:      cpu_state_nxt = cpu_state_wb;
-                    inst_fence:   cpu_state_nxt = cpu_state_fetch;
                     inst_wfi:     cpu_state_nxt = cpu_state_fetch;
                     is_l || is_s: cpu_state_nxt = cpu_state_mem;
-                    is_csr:       cpu_state_nxt = cpu_state_csr;
+                    is_amo:       cpu_state_nxt = cpu_state_mem;
+                    is_csr:       cpu_state_nxt = csr_error ? cpu_state_trap : cpu_state_fetch;
                     default:      cpu_state_nxt = cpu_state_trap;
                 endcase
                 if (interrupt) cpu_state_nxt = cpu_state_trap;
             end
             cpu_state_mem: begin
                 case (1'b1)
-                    mem_ready:                 cpu_state_nxt = cpu_state_wb;
-                    mem_error | mem_unaligned: cpu_state_nxt = cpu_state_trap;
+                    mem_ready:                                 cpu_state_nxt = (ma_first || amo_first) ? cpu_state_mem : cpu_state_fetch;
+                    mem_error | (mem_unaligned && !ma_access): cpu_state_nxt = cpu_state_trap;
+                    sc_skip:                                   cpu_state_nxt = cpu_state_fetch;
                 endcase
             end
-            cpu_state_csr: begin
-                cpu_state_nxt = cpu_state_wb;
-                if (csr_error) cpu_state_nxt = cpu_state_trap;
-            end
-            cpu_state_wb: begin
-                cpu_state_nxt = cpu_state_fetch;
-                if (wb_error) cpu_state_nxt = cpu_state_trap;
-            end
             cpu_state_trap: begin
                 cpu_state_nxt = cpu_state_fetch;
             end
@@ -404,26 +525,17 @@ module algol #(
     // =========================================================================
     // set the new pc
     always @(*) begin
-        pc4 = pc + 4;
+        pc_seq = pc + (inst_c ? 2 : 4);
+        pc_nxt = (is_j || b_taken) ? {add_out[31:1], 1'b0} : pc_seq;
     end
     always @(posedge clk or posedge rst) begin
         if (rst) begin
             pc <= RESET_ADDR;
         end else begin
-            if (cpu_state == cpu_state_execute) begin
-                if (inst_fence) pc <= pc4;
-                if (inst_wfi)   pc <= pc4;
-            end
-            if (cpu_state == cpu_state_wb) begin
-                if (is_j || b_taken) begin
-                    if (!wb_error) pc <= {add_out[31:1], 1'b0};
-                end else  begin
-                    pc <= pc4;
-                end
-            end
-            if (cpu_state == cpu_state_trap) begin
-                pc <= mtvec;
-                if (inst_xret) pc <= mepc;
+            if (exe_commit || mem_commit) pc <= pc_nxt;
+            if (take_trap) begin
+                pc <= trap_vector;
+                if (trap_xret) pc <= mepc;
             end
         end
     end
@@ -435,7 +547,7 @@ module algol #(
                        is_ltu && inst_bltu, ~is_ltu && inst_bgeu};
     // =========================================================================
     // ALU
-    reg [31:0] alu_a, alu_b, add_out, logic_out, shift_out;
+    reg [31:0] alu_a, alu_b, add_out, logic_out, shift_out, zb_out;
     reg [31:0] cmp_b;
     reg        cmp_out;
     wire       is_or, is_and;
@@ -446,19 +558,23 @@ module algol #(
         case (1'b1)
             inst_lui:                     alu_a = 0;
             inst_auipc | inst_jal | is_b: alu_a = pc;
+            inst_sh1add:                  alu_a = {rs1_d[30:0], 1'b0};
+            inst_sh2add:                  alu_a = {rs1_d[29:0], 2'b0};
+            inst_sh3add:                  alu_a = {rs1_d[28:0], 3'b0};
             default:                      alu_a = rs1_d;
         endcase
     end
     // input b
     always @(*) begin
         case (1'b1)
-            inst_lui | inst_auipc:     alu_b = imm_u;
-            inst_jal:                  alu_b = imm_j;
-            is_b:                      alu_b = imm_b;
-            is_s:                      alu_b = imm_s;
-            inst_jalr | is_l | is_imm: alu_b = imm_i;
-            inst_sub:                  alu_b = ~rs2_d;
-            default:                   alu_b = rs2_d;
+            inst_lui | inst_auipc:                       alu_b = imm_u;
+            inst_jal:                                    alu_b = imm_j;
+            is_b:                                        alu_b = imm_b;
+            is_amo | inst_lr:                            alu_b = 0;
+            is_s:                                        alu_b = imm_s;
+            inst_jalr | is_l | is_imm:                   alu_b = imm_i;
+            inst_sub | inst_andn | inst_orn | inst_xnor: alu_b = ~rs2_d;
+            default:                                     alu_b = rs2_d;
         endcase
     end
     // cmp_b
@@ -469,31 +585,68 @@ module algol #(
         endcase
     end
     // output
-    assign is_or  = |{inst_or, inst_ori};
-    assign is_and = |{inst_and, inst_andi};
+    assign is_or  = |{inst_or, inst_ori, inst_orn};
+    assign is_and = |{inst_and, inst_andi, inst_andn};
 
-    always @(posedge clk) begin
-        add_out <= alu_a + alu_b + {31'b0, inst_sub};
+    always @(*) begin
+        add_out = alu_a + alu_b + {31'b0, inst_sub};
     end
 
-    always @(posedge clk) begin
+    always @(*) begin
         case (1'b1)
-            is_and:  logic_out <= alu_a & alu_b;
-            is_or:   logic_out <= alu_a | alu_b;
-            default: logic_out <= alu_a ^ alu_b;
+            is_and:  logic_out = alu_a & alu_b;
+            is_or:   logic_out = alu_a | alu_b;
+            default: logic_out = alu_a ^ alu_b;
         endcase
     end
 
-    always @(posedge clk) begin
-        is_eq  <= rs1_d == cmp_b;
-        is_lt  <= $signed(rs1_d) < $signed(cmp_b);
-        is_ltu <= rs1_d < cmp_b;
+    always @(*) begin
+        is_eq  = rs1_d == cmp_b;
+        is_lt  = $signed(rs1_d) < $signed(cmp_b);
+        is_ltu = rs1_d < cmp_b;
     end
 
     always @(*) begin
         cmp_out = (is_lt && (inst_slt || inst_slti)) || (is_ltu && (inst_sltu || inst_sltiu));
     end
 
+    // Zba/Zbb: single cycle. The shift-and-add and the logic-with-negate
+    // instructions use the adder and the logic unit. min/max use the comparator.
+    always @(*) begin: zb_unit
+        integer i;
+        reg [4:0]  ror_amt;
+        reg [63:0] ror_tmp;
+        reg [5:0]  lz, tz, pop;
+        ror_amt = inst_rol ? -alu_b[4:0] : alu_b[4:0];
+        ror_tmp = {alu_a, alu_a} >> ror_amt;
+        lz      = 32;
+        tz      = 32;
+        pop     = 0;
+        for (i = 0; i < 32; i = i + 1) begin
+            if (alu_a[i])      lz  = 31 - i;
+            if (alu_a[31 - i]) tz  = 31 - i;
+            // verilator lint_off WIDTH
+            pop = pop + alu_a[i];
+            // verilator lint_on WIDTH
+        end
+        (* parallel_case *)
+        case (1'b1)
+            inst_clz:   zb_out = {26'b0, lz};
+            inst_ctz:   zb_out = {26'b0, tz};
+            inst_cpop:  zb_out = {26'b0, pop};
+            inst_max:   zb_out = is_lt  ? rs2_d : rs1_d;
+            inst_maxu:  zb_out = is_ltu ? rs2_d : rs1_d;
+            inst_min:   zb_out = is_lt  ? rs1_d : rs2_d;
+            inst_minu:  zb_out = is_ltu ? rs1_d : rs2_d;
+            inst_sextb: zb_out = {{24{alu_a[7]}}, alu_a[7:0]};
+            inst_sexth: zb_out = {{16{alu_a[15]}}, alu_a[15:0]};
+            inst_zexth: zb_out = {16'b0, alu_a[15:0]};
+            inst_orcb:  zb_out = {{8{|alu_a[31:24]}}, {8{|alu_a[23:16]}}, {8{|alu_a[15:8]}}, {8{|alu_a[7:0]}}};
+            inst_rev8:  zb_out = {alu_a[7:0], alu_a[15:8], alu_a[23:16], alu_a[31:24]};
+            default:    zb_out = ror_tmp[31:0]; // rol/ror/rori
+        endcase
+    end
+
     reg shift_done;
     generate
         if (FAST_SHIFT) begin
@@ -501,17 +654,26 @@ module algol #(
                 shift_done = 0;
             end
 
-            always @(posedge clk) begin
+            always @(*) begin
                 (* parallel_case *)
                 case (1'b1)
-                    |{inst_slli, inst_sll}: shift_out <= alu_a << alu_b[4:0];
-                    |{inst_srli, inst_srl}: shift_out <= alu_a >> alu_b[4:0];
-                    default:                shift_out <= $signed(alu_a) >>> alu_b[4:0];
+                    |{inst_slli, inst_sll}: shift_out = alu_a << alu_b[4:0];
+                    |{inst_srli, inst_srl}: shift_out = alu_a >> alu_b[4:0];
+                    default:                shift_out = $signed(alu_a) >>> alu_b[4:0];
                 endcase
             end
         end else begin
-            reg [4:0] shift_cnt;
-            reg [1:0] shift_state;
+            // SHIFT_STEP bits per cycle. The first cycle shifts the remainder
+            // (shift_cnt % SHIFT_STEP), using a small log-shifter.
+            reg [4:0]  shift_cnt;
+            reg [1:0]  shift_state;
+            wire [4:0] shift_rem, shift_amt;
+            assign shift_rem = shift_cnt & (SHIFT_STEP - 1);
+            assign shift_amt = |shift_rem ? shift_rem : SHIFT_STEP[4:0];
+            // the remainder is a mask: SHIFT_STEP must be a power of 2
+            if (SHIFT_STEP != 1 && SHIFT_STEP != 2 && SHIFT_STEP != 4 && SHIFT_STEP != 8 && SHIFT_STEP != 16) begin: gen_shift_step_error
+                initial $error("algol: SHIFT_STEP must be 1, 2, 4, 8 or 16");
+            end
 
             always @(posedge clk or posedge rst) begin
                 if (rst) begin
@@ -526,18 +688,23 @@ module algol #(
                             shift_state <= 1;
                         end
                     end else if(shift_state == 1) begin
-                        shift_cnt <= shift_cnt - 1;
                         if (shift_cnt == 0) begin
                             shift_done  <= 1;
                             shift_state <= 2;
                         end else begin
-                            shift_out <= {(inst_sra || inst_srai) && shift_out[31], shift_out[31:1]};
-                            if (|{inst_slli, inst_sll}) shift_out <= shift_out << 1;
+                            shift_cnt <= shift_cnt - shift_amt;
+                            (* parallel_case *)
+                            case (1'b1)
+                                |{inst_slli, inst_sll}: shift_out <= shift_out << shift_amt;
+                                |{inst_srli, inst_srl}: shift_out <= shift_out >> shift_amt;
+                                default:                shift_out <= $signed(shift_out) >>> shift_amt;
+                            endcase
                         end
                     end else begin // if (shift_state == 1)
                         shift_state <= 0;
                     end
-                    //
+                    // abort: trap in the middle of the shift
+                    if (cpu_state != cpu_state_execute) shift_state <= 0;
                 end
             end
         end
@@ -578,6 +745,88 @@ module algol #(
             end
         endcase
     end
+    // Misaligned loads/stores (ENABLE_MISALIGNED): a single transaction if the
+    // access is inside a word. Otherwise, two transactions (lower word first),
+    // and the bytes are merged. Not atomic: a fault in the second transaction
+    // traps after the first one is done.
+    reg        ma_second;  // second transaction
+    reg [31:0] ma_low;     // load: first word
+    reg [7:0]  ma_sel;
+    reg [63:0] ma_wdata;
+    wire       ma_access, ma_split, ma_first;
+    wire [63:0] ma_data;
+    //
+    assign ma_access = ENABLE_MISALIGNED && mem_unaligned && !is_amo && !inst_lr;
+    assign ma_split  = ma_access && |ma_sel[7:4];
+    assign ma_first  = ma_split && !ma_second;
+    assign ma_data   = {mem_rdata, ma_second ? ma_low : mem_rdata} >> {add_out[1:0], 3'b000};
+    always @(*) begin
+        ma_sel   = (|{inst_lw, inst_sw} ? 8'b0000_1111 : 8'b0000_0011) << add_out[1:0];
+        ma_wdata = {32'b0, rs2_d} << {add_out[1:0], 3'b000};
+    end
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            ma_second <= 0;
+        end else begin
+            if (cpu_state != cpu_state_mem || mem_error) ma_second <= 0;
+            else if (mem_ready)                          ma_second <= ma_first;
+        end
+    end
+    always @(posedge clk) begin
+        if (mem_ready && ma_first) ma_low <= mem_rdata;
+    end
+    // Atomics (ENABLE_RV32A). AMOs are a read and a write of the same word,
+    // and mem_lock is asserted from the read to the answer of the write: the
+    // bus must not grant other masters in between. LR loads the word and sets
+    // the reservation. The reservation is cleared by SC, by traps, and by the
+    // writes of other masters to the word (snoop_*). SC fails without an
+    // access if the reservation is not valid for the address when the access
+    // starts. Otherwise, it reads the word (locked): the write is done if the
+    // reservation is still valid when the read is answered. Writes before the
+    // read have cleared it by then, and the lock blocks the writes after it.
+    reg        amo_second;  // write of the AMO/SC
+    reg [31:0] amo_rdata;   // read value
+    reg [31:0] amo_out;
+    reg        res_valid;
+    reg [29:0] res_addr;
+    reg        sc_valid;    // reservation valid for the SC, at the start of the access
+    wire       amo_first, sc_skip;
+    //
+    assign amo_first = is_amo && !amo_second && !(inst_sc && !res_valid);
+    assign sc_skip   = inst_sc && !sc_valid;
+    assign mem_lock  = ENABLE_RV32A && cpu_state == cpu_state_mem && is_amo && !sc_skip;
+    always @(*) begin
+        case (instruction[31:27])
+            5'b00001: amo_out = rs2_d;                                                   // amoswap
+            5'b00100: amo_out = amo_rdata ^ rs2_d;                                       // amoxor
+            5'b01000: amo_out = amo_rdata | rs2_d;                                       // amoor
+            5'b01100: amo_out = amo_rdata & rs2_d;                                       // amoand
+            5'b10000: amo_out = $signed(amo_rdata) < $signed(rs2_d) ? amo_rdata : rs2_d; // amomin
+            5'b10100: amo_out = $signed(amo_rdata) < $signed(rs2_d) ? rs2_d : amo_rdata; // amomax
+            5'b11000: amo_out = amo_rdata < rs2_d ? amo_rdata : rs2_d;                   // amominu
+            5'b11100: amo_out = amo_rdata < rs2_d ? rs2_d : amo_rdata;                   // amomaxu
+            default:  amo_out = inst_sc ? rs2_d : amo_rdata + rs2_d;                     // sc, amoadd
+        endcase
+    end
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            amo_second <= 0;
+            res_valid  <= 0;
+        end else begin
+            if (cpu_state != cpu_state_mem || mem_error) amo_second <= 0;
+            else if (mem_ready)                          amo_second <= amo_first;
+            //
+            if (mem_commit && inst_lr)                res_valid <= 1;
+            if ((mem_commit && inst_sc) || take_trap) res_valid <= 0;
+            // a write in the cycle of the LR answer is after the LR read
+            if (snoop_valid && snoop_address[31:2] == (mem_commit && inst_lr ? add_out[31:2] : res_addr)) res_valid <= 0;
+        end
+    end
+    always @(posedge clk) begin
+        if (mem_ready && amo_first)         amo_rdata <= mem_rdata;
+        if (mem_commit && inst_lr)          res_addr  <= add_out[31:2];
+        if (cpu_state == cpu_state_execute) sc_valid  <= res_valid && res_addr == add_out[31:2];
+    end
     // Format data: read
     reg [8:0]  mbyte;
     reg [16:0] mhalf;
@@ -598,48 +847,298 @@ module algol #(
         endcase
     end
     //
-    always @(posedge clk) begin
+    always @(*) begin
         // verilator lint_off WIDTH
         case (1'b1)
-            inst_lb || inst_lbu: mem_dat_i <= $signed(mbyte);
-            inst_lh || inst_lhu: mem_dat_i <= $signed(mhalf);
-            default:             mem_dat_i <= mem_rdata;
+            ma_access && inst_lw: mem_dat_i = ma_data[31:0];
+            ma_access:            mem_dat_i = {{16{inst_lh && ma_data[15]}}, ma_data[15:0]};
+            inst_lb || inst_lbu: mem_dat_i = $signed(mbyte);
+            inst_lh || inst_lhu: mem_dat_i = $signed(mhalf);
+            inst_sc:             mem_dat_i = {31'b0, !amo_second}; // 0: success
+            inst_amo:            mem_dat_i = amo_rdata;
+            default:             mem_dat_i = mem_rdata;
         endcase
         // verilator lint_on WIDTH
     end
-    // Handle the memory port
-    reg mem_enable;
+    // =========================================================================
+    // Instruction prefetch
+    // Fetch the next instruction while the current one is in the execute state.
+    // Only for instructions that do not use the memory port. Jumps and branches
+    // are resolved in the first cycle of the execute state, so the prefetch uses
+    // the real next pc. The prefetch is squashed in case of traps. A squashed
+    // transaction is not aborted: the fetch waits until the bus is free.
+    // With RV32C, only if the next pc is word-aligned: the upper half of a
+    // word is usually in the realignment buffer. With the instruction port
+    // (ENABLE_HARVARD), loads and stores can also prefetch.
+    reg        pf_busy, pf_kill, pf_valid, pf_error;
+    reg [31:0] pf_addr, pf_data;
+    wire       pf_candidate, pf_issue, pf_req, pf_flush, pf_drop;
+    //
+    assign pf_candidate = |{use_alu, is_shift, is_mul, is_div, is_cfu, is_csr && !csr_error, ENABLE_HARVARD && (is_l || is_s)} &&
+                          !target_unaligned && !(ENABLE_RV32C && pc_nxt[1]);
+    assign pf_issue     = ENABLE_PREFETCH && cpu_state == cpu_state_execute && pf_candidate && !interrupt && !pf_busy && !pf_valid;
+    assign pf_req       = pf_issue || pf_busy;
+    assign pf_flush     = take_trap;
+    assign pf_drop      = pf_busy && pf_kill;
+
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            pf_busy  <= 0;
+            pf_kill  <= 0;
+            pf_valid <= 0;
+        end else begin
+            if (pf_req) begin
+                if (if_ready || if_error) begin
+                    pf_busy  <= 0;
+                    pf_kill  <= 0;
+                    pf_valid <= !(pf_kill || pf_flush || cpu_state == cpu_state_fetch); // in fetch: used right away
+                end else begin
+                    pf_busy  <= 1;
+                    pf_kill  <= pf_kill || pf_flush;
+                end
+            end else if (pf_flush || cpu_state == cpu_state_fetch) begin
+                pf_valid <= 0;
+            end
+        end
+    end
     always @(posedge clk) begin
-        mem_enable <= cpu_state == cpu_state_mem && !mem_unaligned; // enable mem port if no exceptions
+        if (pf_issue) pf_addr <= pc_nxt;
+        if (pf_req && (if_ready || if_error)) begin
+            pf_data  <= if_rdata;
+            pf_error <= if_error;
+        end
+    end
+    // =========================================================================
+    // Fetch unit
+    wire [31:0] fetch_word;
+    wire        fetch_word_ok;
+    //
+    assign fetch_word    = pf_valid ? pf_data : if_rdata;
+    assign fetch_word_ok = pf_valid ? !pf_error : if_ready && !pf_drop;
+    assign fetch_error   = pf_valid ? pf_error  : if_error && !pf_drop;
+    generate
+        if (ENABLE_RV32C) begin
+            // Instructions are 16-bit aligned. The upper half of the last
+            // fetched word is kept in the realignment buffer (fb_*): a 32-bit
+            // instruction in the upper half of a word needs the next word.
+            reg        fb_valid;
+            reg [29:0] fb_addr;
+            reg [15:0] fb_data;
+            reg        fetch_second;  // waiting for the second word of the instruction
+            reg [15:0] fetch_half;    // first half of the instruction
+            reg [31:0] inst_raw;
+            reg        inst_done, inst_split;
+            wire       fb_hit, first_in_fb;
+            wire [15:0] first_half;
+            //
+            assign fb_hit        = fb_valid && fb_addr == pc[31:2];
+            assign first_in_fb   = pc[1] && fb_hit && !fetch_second;
+            assign first_half    = fetch_second ? fetch_half : fb_data;
+            assign fetch_bus     = !(first_in_fb && fb_data[1:0] != 2'b11);
+            assign fetch_address = {pc[31:2] + {29'b0, fetch_second || first_in_fb}, 2'b00};
+            // get the instruction
+            always @(*) begin
+                inst_done  = 0;
+                inst_split = 0;
+                inst_raw   = fetch_word;
+                case (1'b1)
+                    !fetch_bus: begin
+                        inst_done = !pf_busy; // wait for a squashed prefetch
+                        inst_raw  = {16'b0, fb_data};
+                    end
+                    fetch_second || first_in_fb: begin
+                        inst_done = fetch_word_ok;
+                        inst_raw  = {fetch_word[15:0], first_half};
+                    end
+                    pc[1]: begin
+                        inst_done  = fetch_word_ok && fetch_word[17:16] != 2'b11;
+                        inst_split = fetch_word_ok && fetch_word[17:16] == 2'b11;
+                        inst_raw   = {16'b0, fetch_word[31:16]};
+                    end
+                    default: begin
+                        inst_done = fetch_word_ok;
+                    end
+                endcase
+            end
+            assign inst_c_q       = inst_raw[1:0] != 2'b11;
+            assign instruction_cq = inst_raw[15:0];
+            assign instruction_q  = inst_c_q ? rvc_expand(inst_raw[15:0]) : inst_raw;
+            assign fetch_ready    = inst_done;
+            //
+            always @(posedge clk or posedge rst) begin
+                if (rst) begin
+                    fb_valid     <= 0;
+                    fetch_second <= 0;
+                end else begin
+                    if (cpu_state == cpu_state_fetch && fetch_bus && fetch_word_ok && !inst_split) begin
+                        // keep the upper half of the word
+                        fb_valid <= 1;
+                        fb_addr  <= fetch_address[31:2];
+                        fb_data  <= fetch_word[31:16];
+                    end
+                    if (cpu_state == cpu_state_fetch && inst_split) begin
+                        fetch_second <= 1;
+                        fetch_half   <= fetch_word[31:16];
+                    end
+                    if (cpu_state != cpu_state_fetch) fetch_second <= 0;
+                    if (mem_fencei) fb_valid <= 0;
+                end
+            end
+        end else begin
+            assign fetch_bus      = 1;
+            assign fetch_address  = pc;
+            assign inst_c_q       = 0;
+            assign instruction_cq = 0;
+            assign instruction_q  = fetch_word;
+            assign fetch_ready    = fetch_word_ok;
+        end
+    endgenerate
+    // Expand a compressed instruction. Reserved or unsupported (floating point)
+    // instructions are expanded to an illegal instruction (all zeros).
+    function [31:0] rvc_expand;
+        input [15:0] c;
+        reg [4:0]  rd, rs1, rs2, rdp, rs1p, rs2p;
+        reg [11:0] imm_ci, imm_lw, imm_lwsp, imm_swsp, imm_4spn, imm_16sp;
+        reg [20:0] imm_cj;
+        reg [12:0] imm_cb;
+        begin
+            rd       = c[11:7];
+            rs1      = c[11:7];
+            rs2      = c[6:2];
+            rdp      = {2'b01, c[4:2]};
+            rs1p     = {2'b01, c[9:7]};
+            rs2p     = {2'b01, c[4:2]};
+            imm_ci   = {{7{c[12]}}, c[6:2]};
+            imm_lw   = {5'b0, c[5], c[12:10], c[6], 2'b0};
+            imm_lwsp = {4'b0, c[3:2], c[12], c[6:4], 2'b0};
+            imm_swsp = {4'b0, c[8:7], c[12:9], 2'b0};
+            imm_4spn = {2'b0, c[10:7], c[12:11], c[5], c[6], 2'b0};
+            imm_16sp = {{3{c[12]}}, c[4:3], c[5], c[2], c[6], 4'b0};
+            imm_cj   = {{10{c[12]}}, c[8], c[10:9], c[6], c[7], c[2], c[11], c[5:3], 1'b0};
+            imm_cb   = {{5{c[12]}}, c[6:5], c[2], c[11:10], c[4:3], 1'b0};
+            rvc_expand = 32'b0;
+            case ({c[15:13], c[1:0]})
+                // quadrant 0
+                5'b000_00: if (|c[12:5]) rvc_expand = {imm_4spn, 5'd2, 3'b000, rdp, 7'b0010011};           // c.addi4spn
+                5'b010_00: rvc_expand = {imm_lw, rs1p, 3'b010, rdp, 7'b0000011};                           // c.lw
+                5'b110_00: rvc_expand = {imm_lw[11:5], rs2p, rs1p, 3'b010, imm_lw[4:0], 7'b0100011};      // c.sw
+                // quadrant 1
+                5'b000_01: rvc_expand = {imm_ci, rd, 3'b000, rd, 7'b0010011};                              // c.addi
+                5'b001_01: rvc_expand = {imm_cj[20], imm_cj[10:1], imm_cj[11], imm_cj[19:12], 5'd1, 7'b1101111}; // c.jal
+                5'b010_01: rvc_expand = {imm_ci, 5'd0, 3'b000, rd, 7'b0010011};                            // c.li
+                5'b011_01: begin
+                    if (rd == 5'd2) begin
+                        if (|{c[12], c[6:2]}) rvc_expand = {imm_16sp, 5'd2, 3'b000, 5'd2, 7'b0010011};      // c.addi16sp
+                    end else begin
+                        if (|{c[12], c[6:2]}) rvc_expand = {{15{c[12]}}, c[6:2], rd, 7'b0110111};           // c.lui
+                    end
+                end
+                5'b100_01: begin
+                    case (c[11:10])
+                        2'b00: if (!c[12]) rvc_expand = {7'b0000000, c[6:2], rs1p, 3'b101, rs1p, 7'b0010011}; // c.srli
+                        2'b01: if (!c[12]) rvc_expand = {7'b0100000, c[6:2], rs1p, 3'b101, rs1p, 7'b0010011}; // c.srai
+                        2'b10: rvc_expand = {imm_ci, rs1p, 3'b111, rs1p, 7'b0010011};                         // c.andi
+                        2'b11: begin
+                            if (!c[12]) begin
+                                case (c[6:5])
+                                    2'b00: rvc_expand = {7'b0100000, rs2p, rs1p, 3'b000, rs1p, 7'b0110011};   // c.sub
+                                    2'b01: rvc_expand = {7'b0000000, rs2p, rs1p, 3'b100, rs1p, 7'b0110011};   // c.xor
+                                    2'b10: rvc_expand = {7'b0000000, rs2p, rs1p, 3'b110, rs1p, 7'b0110011};   // c.or
+                                    2'b11: rvc_expand = {7'b0000000, rs2p, rs1p, 3'b111, rs1p, 7'b0110011};   // c.and
+                                endcase
+                            end
+                        end
+                    endcase
+                end
+                5'b101_01: rvc_expand = {imm_cj[20], imm_cj[10:1], imm_cj[11], imm_cj[19:12], 5'd0, 7'b1101111}; // c.j
+                5'b110_01: rvc_expand = {imm_cb[12], imm_cb[10:5], 5'd0, rs1p, 3'b000, imm_cb[4:1], imm_cb[11], 7'b1100011}; // c.beqz
+                5'b111_01: rvc_expand = {imm_cb[12], imm_cb[10:5], 5'd0, rs1p, 3'b001, imm_cb[4:1], imm_cb[11], 7'b1100011}; // c.bnez
+                // quadrant 2
+                5'b000_10: if (!c[12]) rvc_expand = {7'b0000000, c[6:2], rd, 3'b001, rd, 7'b0010011};     // c.slli
+                5'b010_10: if (|rd) rvc_expand = {imm_lwsp, 5'd2, 3'b010, rd, 7'b0000011};                // c.lwsp
+                5'b100_10: begin
+                    case ({c[12], |rs1, |rs2})
+                        3'b010:  rvc_expand = {12'b0, rs1, 3'b000, 5'd0, 7'b1100111};                      // c.jr
+                        3'b001,
+                        3'b011:  rvc_expand = {7'b0000000, rs2, 5'd0, 3'b000, rd, 7'b0110011};            // c.mv
+                        3'b100:  rvc_expand = 32'b00000000000100000000000001110011;                         // c.ebreak
+                        3'b110:  rvc_expand = {12'b0, rs1, 3'b000, 5'd1, 7'b1100111};                      // c.jalr
+                        3'b101,
+                        3'b111:  rvc_expand = {7'b0000000, rs2, rd, 3'b000, rd, 7'b0110011};              // c.add
+                        default: rvc_expand = 32'b0;
+                    endcase
+                end
+                5'b110_10: rvc_expand = {imm_swsp[11:5], rs2, 5'd2, 3'b010, imm_swsp[4:0], 7'b0100011};  // c.swsp
+                default:   rvc_expand = 32'b0;
+            endcase
+        end
+    endfunction
+    // =========================================================================
+    // Handle the memory port
+    // mem_fetch: the current transaction is an instruction fetch.
+    // mem_fencei: FENCE.I is committed (one cycle pulse).
+    // mem_fence: FENCE/FENCE.I in execute. The instruction waits while
+    // mem_fence_wait is high (posted writes not done yet).
+    // Instruction fetches (if_*) use the instruction port if ENABLE_HARVARD,
+    // or share the memory port with loads/stores.
+    assign mem_fencei = exe_commit && inst_fence && instruction[12];
+    assign mem_fence  = cpu_state == cpu_state_execute && inst_fence;
+    assign if_rdata   = ENABLE_HARVARD ? imem_rdata : mem_rdata;
+    assign if_ready   = ENABLE_HARVARD ? imem_ready : mem_ready;
+    assign if_error   = ENABLE_HARVARD ? imem_error : mem_error;
+    always @(*) begin
+        if (pf_req) begin
+            if_address = pf_busy ? pf_addr : pc_nxt;
+            if_valid   = 1;
+        end else begin
+            if_address = fetch_address;
+            if_valid   = cpu_state == cpu_state_fetch && !pf_valid && fetch_bus;
+        end
     end
     always @(*) begin
-        (* parallel_case *)
-        case (cpu_state)
-            cpu_state_fetch: begin
-                mem_address = pc;
-                mem_wdata   = 32'bx;
-                mem_wsel    = 0;
+        imem_address = if_address;
+        imem_valid   = ENABLE_HARVARD && if_valid;
+    end
+    always @(*) begin
+        if (if_valid && !ENABLE_HARVARD) begin
+            mem_address = if_address;
+            mem_wdata   = 32'bx;
+            mem_wsel    = 0;
+            mem_valid   = 1;
+            mem_fetch   = 1;
+        end else if (cpu_state == cpu_state_mem) begin
+            mem_address = add_out;
+            mem_wdata   = mem_dat_o;
+            mem_wsel    = mem_sel_o;
+            mem_valid   = !mem_unaligned; // enable mem port if no exceptions
+            mem_fetch   = 0;
+            if (ma_access) begin
+                mem_address = {add_out[31:2] + {29'b0, ma_second}, 2'b00};
+                mem_wdata   = ma_second ? ma_wdata[63:32] : ma_wdata[31:0];
+                mem_wsel    = !is_s ? 4'b0 : ma_second ? ma_sel[7:4] : ma_sel[3:0];
                 mem_valid   = 1;
             end
-            cpu_state_mem: begin
-                mem_address = add_out;
-                mem_wdata   = mem_dat_o;
-                mem_wsel    = mem_sel_o;
-                mem_valid   = mem_enable;
+            if (is_amo) begin
+                mem_wdata   = amo_out;
+                mem_wsel    = {4{amo_second}};
+                mem_valid   = !mem_unaligned && !sc_skip;
             end
-            default: begin
-                mem_address = 32'hx;
-                mem_wdata   = 32'hx;
-                mem_wsel    = 0;
-                mem_valid   = 0;
-            end
-        endcase
+        end else begin
+            mem_address = 32'hx;
+            mem_wdata   = 32'hx;
+            mem_wsel    = 0;
+            mem_valid   = 0;
+            mem_fetch   = 0;
+        end
     end
     // =========================================================================
     // CSR
     wire [31:0] mstatus, mie, mcause, mip;
     reg [31:0]  mscratch, mtval;
-    reg [29:0]  _mtvec, _mepc;
+    reg [29:0]  _mtvec;
+    reg         mtvec_mode;
+    wire [31:0] trap_vector;
+    reg [30:0]  _mepc;
     wire [31:0] mtvec, mepc;
     // msatus fields
     reg         mstatus_mpie;
@@ -650,12 +1149,22 @@ module algol #(
     reg         mcause_interrupt;
     reg [3:0]   mcause_mcode, ecode;
     reg [63:0]  cycle, instret;
+    // performance monitoring
+    reg [31:0]  mcountinhibit;
+    reg [63:0]  hpm_count, ucount;  // selected by csr_index
+    reg [3:0]   hpm_event;
+    reg [15:0]  hpm_trigger;
     // access check
     reg         is_misa, is_mhartid, is_mstatus, is_mie, is_mtvec, is_mscratch, is_mepc, is_mcause,
                 is_mtval, is_mip, is_cycle, is_cycleh, is_instret, is_instreth;
+    reg         is_mcountinhibit, is_mhpmevent, is_mhpmcounter, is_mhpmcounterh, is_ucounter, is_ucounterh;
+    reg         is_mshadow;
     reg         _is_misa, _is_mhartid, _is_mstatus, _is_mie, _is_mtvec, _is_mscratch, _is_mepc, _is_mcause,
                 _is_mtval, _is_mip, _is_cycle, _is_cycleh, _is_instret, _is_instreth, _is_mimpid, _is_marchid, _is_mvendorid;
-    reg         undef_register;
+    reg         _is_mcountinhibit, _is_mhpmevent, _is_mhpmcounter, _is_mhpmcounterh, _is_ucounter, _is_ucounterh;
+    reg         _is_mshadow;
+    reg [4:0]   csr_index;
+    reg         undef_register, ro_register;
     //
     reg [31:0]  csr_dat_o, csr_dat_i, csr_wdata, edata;
     reg         csr_wcmd, csr_scmd, csr_ccmd;
@@ -666,17 +1175,21 @@ module algol #(
     assign mip     = {20'b0, xint_meip, 3'b0, xint_mtip, 3'b0, xint_msip, 3'b0};
     assign mie     = {20'b0, mie_meie, 3'b0, mie_mtie, 3'b0, mie_msie, 3'b0};
     assign mcause  = {mcause_interrupt, 27'b0, mcause_mcode};
-    assign mtvec   = {_mtvec, 2'b0};
-    assign mepc    = {_mepc, 2'b0};
+    assign mtvec   = {_mtvec, 1'b0, ENABLE_VECTORED && mtvec_mode};
+    // Vectored mode (ENABLE_VECTORED): interrupts jump to BASE + 4*cause. BASE
+    // is 64-byte aligned in this mode, so the cause is just concatenated.
+    assign trap_vector = (ENABLE_VECTORED && mtvec_mode && trap_int) ? {_mtvec[29:4], ecode, 2'b0} : {_mtvec, 2'b0};
+    assign mepc    = {_mepc[30:1], ENABLE_RV32C && _mepc[0], 1'b0};
 
-    assign csr_wen   = |{csr_wcmd, csr_scmd, csr_ccmd} && (cpu_state == cpu_state_csr);
-    assign take_trap = cpu_state == cpu_state_trap;
-    assign csr_error = is_csr && undef_register;
+    assign csr_wen     = |{csr_wcmd, csr_scmd, csr_ccmd} && is_csr && exe_commit;
+    assign take_trap   = cpu_state == cpu_state_trap;
+    assign csr_error   = is_csr && (undef_register || (ro_register && |{csr_wcmd, csr_scmd, csr_ccmd}));
+    assign csr_address = instruction_q[31:20];
 
-    always @(posedge clk) begin
-        csr_wcmd <= inst_csrrw || inst_csrrwi;
-        csr_scmd <= is_csrs && |instruction[19:15]; // cmd is valid only if rs1 != 0
-        csr_ccmd <= is_csrc && |instruction[19:15]; // cmd is valid only if rs1 != 0
+    always @(*) begin
+        csr_wcmd = inst_csrrw || inst_csrrwi;
+        csr_scmd = is_csrs && |instruction[19:15]; // cmd is valid only if rs1 != 0
+        csr_ccmd = is_csrc && |instruction[19:15]; // cmd is valid only if rs1 != 0
     end
     // ---------------------------------------------------------------------
     // check CSR address
@@ -698,48 +1211,77 @@ module algol #(
         _is_mimpid    = csr_address == MIMPID;
         _is_marchid   = csr_address == MARCHID;
         _is_mvendorid = csr_address == MVENDORID;
+        // counter ranges: the index is csr_address[4:0]. Unimplemented
+        // mhpmcounters and mhpmevents are read-only zero.
+        _is_mcountinhibit = ENABLE_COUNTERS && csr_address == MCOUNTINHIBIT;
+        _is_mhpmevent     = ENABLE_COUNTERS && csr_address[11:5] == MHPMEVENT3[11:5] && csr_address[4:0] >= 3;
+        _is_mhpmcounter   = ENABLE_COUNTERS && csr_address[11:5] == MHPMCOUNTER3[11:5] && csr_address[4:0] >= 3;
+        _is_mhpmcounterh  = ENABLE_COUNTERS && csr_address[11:5] == MHPMCOUNTER3H[11:5] && csr_address[4:0] >= 3;
+        _is_ucounter      = ENABLE_COUNTERS && csr_address[11:5] == CYCLE[11:5];
+        _is_ucounterh     = ENABLE_COUNTERS && csr_address[11:5] == CYCLEH[11:5];
+        _is_mshadow       = ENABLE_SHADOW_REGS && csr_address == MSHADOW;
     end
     always @(posedge clk) begin
-        // valid 1st cycle of CSR state
-        is_misa        <= _is_misa;
-        is_mhartid     <= _is_mhartid;
-        is_mstatus     <= _is_mstatus;
-        is_mie         <= _is_mie;
-        is_mtvec       <= _is_mtvec;
-        is_mscratch    <= _is_mscratch;
-        is_mepc        <= _is_mepc;
-        is_mcause      <= _is_mcause;
-        is_mtval       <= _is_mtval;
-        is_mip         <= _is_mip;
-        is_cycle       <= _is_cycle;
-        is_cycleh      <= _is_cycleh;
-        is_instret     <= _is_instret;
-        is_instreth    <= _is_instreth;
-        undef_register <= ~|{_is_misa, _is_mhartid, _is_mstatus, _is_mie, _is_mtvec,
-                             _is_mscratch, _is_mepc, _is_mcause, _is_mtval, _is_mip,
-                             _is_cycle, _is_cycleh, _is_instret, _is_instreth,
-                             _is_mimpid, _is_marchid, _is_mvendorid};
+        // valid 1st cycle of execute state
+        if (cpu_state == cpu_state_fetch) begin
+            is_misa          <= _is_misa;
+            is_mhartid       <= _is_mhartid;
+            is_mstatus       <= _is_mstatus;
+            is_mie           <= _is_mie;
+            is_mtvec         <= _is_mtvec;
+            is_mscratch      <= _is_mscratch;
+            is_mepc          <= _is_mepc;
+            is_mcause        <= _is_mcause;
+            is_mtval         <= _is_mtval;
+            is_mip           <= _is_mip;
+            is_cycle         <= _is_cycle;
+            is_cycleh        <= _is_cycleh;
+            is_instret       <= _is_instret;
+            is_instreth      <= _is_instreth;
+            is_mcountinhibit <= _is_mcountinhibit;
+            is_mhpmevent     <= _is_mhpmevent;
+            is_mhpmcounter   <= _is_mhpmcounter;
+            is_mhpmcounterh  <= _is_mhpmcounterh;
+            is_ucounter      <= _is_ucounter;
+            is_ucounterh     <= _is_ucounterh;
+            is_mshadow       <= _is_mshadow;
+            csr_index        <= csr_address[4:0];
+            undef_register   <= ~|{_is_misa, _is_mhartid, _is_mstatus, _is_mie, _is_mtvec,
+                                   _is_mscratch, _is_mepc, _is_mcause, _is_mtval, _is_mip,
+                                   _is_cycle, _is_cycleh, _is_instret, _is_instreth,
+                                   _is_mimpid, _is_marchid, _is_mvendorid,
+                                   _is_mcountinhibit, _is_mhpmevent, _is_mhpmcounter, _is_mhpmcounterh,
+                                   _is_ucounter, _is_ucounterh, _is_mshadow};
+            ro_register      <= _is_ucounter || _is_ucounterh;
+        end
     end
     // ---------------------------------------------------------------------
     // CSR: read registers
     always @(*) begin
         (* parallel_case *)
         case (1'b1)
-            is_misa:     csr_dat_o = {2'b01, 4'b0, 26'b00000000000000000100000000};
-            is_mhartid:  csr_dat_o = HART_ID;
-            is_mstatus:  csr_dat_o = mstatus;
-            is_mie:      csr_dat_o = mie;
-            is_mtvec:    csr_dat_o = mtvec;
-            is_mscratch: csr_dat_o = mscratch;
-            is_mepc:     csr_dat_o = mepc;
-            is_mcause:   csr_dat_o = mcause;
-            is_mtval:    csr_dat_o = mtval;
-            is_mip:      csr_dat_o = mip;
-            is_cycle:    csr_dat_o = cycle[31:0];
-            is_cycleh:   csr_dat_o = cycle[63:32];
-            is_instret:  csr_dat_o = instret[31:0];
-            is_instreth: csr_dat_o = instret[63:32];
-            default:     csr_dat_o = 32'b0;
+            is_misa:          csr_dat_o = {2'b01, 4'b0, 23'b00000000000000000100000, ENABLE_RV32C[0], 1'b0, ENABLE_RV32A[0]};
+            is_mhartid:       csr_dat_o = HART_ID;
+            is_mstatus:       csr_dat_o = mstatus;
+            is_mie:           csr_dat_o = mie;
+            is_mtvec:         csr_dat_o = mtvec;
+            is_mscratch:      csr_dat_o = mscratch;
+            is_mepc:          csr_dat_o = mepc;
+            is_mcause:        csr_dat_o = mcause;
+            is_mtval:         csr_dat_o = mtval;
+            is_mip:           csr_dat_o = mip;
+            is_cycle:         csr_dat_o = cycle[31:0];
+            is_cycleh:        csr_dat_o = cycle[63:32];
+            is_instret:       csr_dat_o = instret[31:0];
+            is_instreth:      csr_dat_o = instret[63:32];
+            is_mcountinhibit: csr_dat_o = mcountinhibit;
+            is_mhpmevent:     csr_dat_o = {28'b0, hpm_event};
+            is_mhpmcounter:   csr_dat_o = hpm_count[31:0];
+            is_mhpmcounterh:  csr_dat_o = hpm_count[63:32];
+            is_ucounter:      csr_dat_o = ucount[31:0];
+            is_ucounterh:     csr_dat_o = ucount[63:32];
+            is_mshadow:       csr_dat_o = {29'b0, shadow_pbank, shadow_bank, shadow_en};
+            default:          csr_dat_o = 32'b0;
         endcase
     end
     // ---------------------------------------------------------------------
@@ -767,7 +1309,7 @@ module algol #(
                     case (1'b1)
                         csr_wen && is_cycle:  cycle[31:0]  <= csr_wdata;
                         csr_wen && is_cycleh: cycle[63:32] <= csr_wdata;
-                        default:              cycle <= cycle + 1;
+                        !mcountinhibit[0]:    cycle <= cycle + 1;
                     endcase
                 end
             end
@@ -778,10 +1320,9 @@ module algol #(
                 end else begin
                     (* parallel_case *)
                     case(1'b1)
-                        csr_wen && is_instret:       instret[31: 0]  <= csr_wdata;
-                        csr_wen && is_instreth:      instret[63: 32] <= csr_wdata;
-                        cpu_state == cpu_state_wb:   instret <= instret + 1;
-                        cpu_state == cpu_state_trap: instret <= instret + 1;
+                        csr_wen && is_instret:                 instret[31: 0]  <= csr_wdata;
+                        csr_wen && is_instreth:                instret[63: 32] <= csr_wdata;
+                        (exe_commit || mem_commit || take_trap) && !mcountinhibit[2]: instret <= instret + 1;
                     endcase
                 end
             end
@@ -792,18 +1333,98 @@ module algol #(
             end
         end
     endgenerate
+    // ---------------------------------------------------------------------
+    // Performance monitoring.
+    // mhpmevent selects the event counted by the mhpmcounter:
+    // 0: none. 1: fetch stall cycles. 2: loads. 3: stores. 4: taken branches.
+    // 5: traps (exceptions and interrupts). 6: interrupts. 7: multiplier busy
+    // cycles. 8: divider busy cycles. 9: shift cycles. 10: CFU busy cycles.
+    always @(*) begin
+        hpm_trigger     = 16'b0;
+        hpm_trigger[1]  = cpu_state == cpu_state_fetch && !fetch_ready;
+        hpm_trigger[2]  = mem_commit && is_l;
+        hpm_trigger[3]  = mem_commit && is_s;
+        hpm_trigger[4]  = exe_commit && b_taken;
+        hpm_trigger[5]  = take_trap && !trap_xret;
+        hpm_trigger[6]  = take_trap && trap_int;
+        hpm_trigger[7]  = cpu_state == cpu_state_execute && is_mul;
+        hpm_trigger[8]  = cpu_state == cpu_state_execute && is_div;
+        hpm_trigger[9]  = cpu_state == cpu_state_execute && is_shift;
+        hpm_trigger[10] = cpu_state == cpu_state_execute && is_cfu;
+    end
+    // user shadows. time follows the platform timer: it does not depend on
+    // mcountinhibit or on writes to mcycle.
+    always @(*) begin
+        case (csr_index)
+            5'd0:    ucount = cycle;
+            5'd1:    ucount = xtime;
+            5'd2:    ucount = instret;
+            default: ucount = hpm_count;
+        endcase
+    end
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            mcountinhibit <= 0;
+        end else if (csr_wen && is_mcountinhibit) begin
+            mcountinhibit <= csr_wdata & MCOUNTINHIBIT_MASK;
+        end
+    end
+
+    generate
+        if (ENABLE_COUNTERS && HPM_COUNTERS > 0) begin: gen_hpm
+            reg [63:0] counter [3:HPM_COUNTERS + 2];
+            reg [3:0]  evsel   [3:HPM_COUNTERS + 2];
+            //
+            always @(*) begin: hpm_read
+                integer i;
+                hpm_count = 64'b0;
+                hpm_event = 4'b0;
+                for (i = 3; i < HPM_COUNTERS + 3; i = i + 1) begin
+                    if (csr_index == i[4:0]) begin
+                        hpm_count = counter[i];
+                        hpm_event = evsel[i];
+                    end
+                end
+            end
+            always @(posedge clk or posedge rst) begin: hpm_update
+                integer i;
+                if (rst) begin
+                    for (i = 3; i < HPM_COUNTERS + 3; i = i + 1) begin
+                        counter[i] <= 0;
+                        evsel[i]   <= 0;
+                    end
+                end else begin
+                    for (i = 3; i < HPM_COUNTERS + 3; i = i + 1) begin
+                        if (csr_wen && is_mhpmcounter && csr_index == i[4:0])
+                            counter[i][31:0] <= csr_wdata;
+                        else if (csr_wen && is_mhpmcounterh && csr_index == i[4:0])
+                            counter[i][63:32] <= csr_wdata;
+                        else if (!mcountinhibit[i] && hpm_trigger[evsel[i]])
+                            counter[i] <= counter[i] + 1;
+                        if (csr_wen && is_mhpmevent && csr_index == i[4:0])
+                            evsel[i] <= csr_wdata[3:0];
+                    end
+                end
+            end
+        end else begin
+            always @(*) begin
+                hpm_count = 64'b0;
+                hpm_event = 4'b0;
+            end
+        end
+    endgenerate
     // mstatus
     always @(posedge clk or posedge rst) begin
         if (rst) begin
             mstatus_mpie <= 0;
             mstatus_mie  <= 0;
         end else begin
-            if (take_trap) begin
-                mstatus_mpie <= mstatus_mie;
-                mstatus_mie  <= 0;
-            end else if (inst_xret) begin
+            if (take_trap && trap_xret) begin
                 mstatus_mpie <= 1;
                 mstatus_mie  <= mstatus_mpie;
+            end else if (take_trap) begin
+                mstatus_mpie <= mstatus_mie;
+                mstatus_mie  <= 0;
             end else if (csr_wen && is_mstatus) begin
                 mstatus_mpie <= csr_wdata[7];
                 mstatus_mie  <= csr_wdata[3];
@@ -812,16 +1433,16 @@ module algol #(
     end
     // mepc
     always @(posedge clk) begin
-        if (take_trap)               _mepc <= pc[31:2];
-        else if (csr_wen && is_mepc) _mepc <= csr_wdata[31:2];
+        if (take_trap && !trap_xret) _mepc <= pc[31:1];
+        else if (csr_wen && is_mepc) _mepc <= csr_wdata[31:1];
     end
     // mcause
     always @(posedge clk or posedge rst) begin
         if (rst) begin
             mcause_interrupt <= 0; // This is not needed. But this reduces LUT count (._. )
         end else begin
-            if (take_trap) begin
-                mcause_interrupt <= interrupt;
+            if (take_trap && !trap_xret) begin
+                mcause_interrupt <= trap_int;
                 mcause_mcode     <= ecode;
             end else if (csr_wen && is_mcause) begin
                 mcause_interrupt <= csr_wdata[31];
@@ -831,7 +1452,7 @@ module algol #(
     end
     // mtval
     always @(posedge clk) begin
-        if (take_trap)                mtval <= edata;
+        if (take_trap && !trap_xret)  mtval <= edata;
         else if (csr_wen && is_mtval) mtval <= csr_wdata;
     end
     // mie
@@ -843,29 +1464,59 @@ module algol #(
     end
     // others
     always @(posedge clk) begin
-        if(csr_wen && is_mtvec) _mtvec <= csr_wdata[31:2];
+        if(csr_wen && is_mtvec) begin
+            _mtvec     <= csr_wdata[31:2];
+            mtvec_mode <= csr_wdata[0];
+            if (ENABLE_VECTORED && csr_wdata[0]) _mtvec[3:0] <= 4'b0;
+        end
     end
     always @(posedge clk) begin
         if(csr_wen && is_mscratch) mscratch <= csr_wdata;
     end
+    // mshadow (ENABLE_SHADOW_REGS): b0: enable. b1: current bank. b2: previous
+    // bank. Interrupts switch to bank 1 if enabled, exceptions keep the bank, and
+    // mret restores the previous bank. Like mepc, nested traps must save it.
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            shadow_en    <= 0;
+            shadow_bank  <= 0;
+            shadow_pbank <= 0;
+        end else begin
+            if (take_trap && trap_xret) begin
+                shadow_bank  <= shadow_pbank;
+            end else if (take_trap) begin
+                shadow_pbank <= shadow_bank;
+                shadow_bank  <= shadow_bank || (shadow_en && trap_int);
+            end else if (csr_wen && is_mshadow) begin
+                {shadow_pbank, shadow_bank, shadow_en} <= csr_wdata[2:0];
+            end
+        end
+    end
     // =========================================================================
     // Exceptions
     reg [2:0] pend_int;
-    reg mem_unaligned, if_unaligned, wb_error;
+    reg mem_unaligned, if_unaligned, target_unaligned;
+    reg trap_int, trap_xret;
     //
     assign interrupt = |pend_int;
     always @(posedge clk) begin
         pend_int <= 0;
         if (mstatus_mie) pend_int <= {xint_meip & mie_meie, xint_msip & mie_msie, xint_mtip & mie_mtie};
     end
+    // Latch the kind of trap: the decoded instruction and the pending
+    // interrupts can change while in the trap state.
+    always @(posedge clk) begin
+        trap_int  <= cpu_state == cpu_state_execute && interrupt;
+        trap_xret <= cpu_state == cpu_state_execute && !interrupt && inst_xret;
+    end
     //
     always @(*) begin
-        wb_error     = (is_j || b_taken) && add_out[1];
-        if_unaligned = |pc[1:0];
+        target_unaligned = (is_j || b_taken) && add_out[1] && !ENABLE_RV32C;
+        if_unaligned     = ENABLE_RV32C ? pc[0] : |pc[1:0];
         case (1'b1)
-            add_out[0] && |{inst_lh, inst_lhu, inst_sh}: mem_unaligned = 1;
-            |add_out[1:0] && |{inst_lw, inst_sw}:        mem_unaligned = 1;
-            default:                                     mem_unaligned = 0;
+            add_out[0] && |{inst_lh, inst_lhu, inst_sh}:           mem_unaligned = 1;
+            |add_out[1:0] && |{inst_lw, inst_sw, is_amo, inst_lr}: mem_unaligned = 1;
+            default:                                               mem_unaligned = 0;
         endcase
     end
     //
@@ -874,10 +1525,10 @@ module algol #(
             cpu_state_fetch: begin
                 edata <= pc;
                 ecode <= E_INST_ADDR_MISALIGNED;
-                if (mem_error) ecode <= E_INST_ACCESS_FAULT;
+                if (fetch_error) ecode <= E_INST_ACCESS_FAULT;
             end
             cpu_state_execute: begin
-                edata <= instruction;
+                edata <= inst_c ? {16'b0, instruction_c} : instruction;
                 ecode <= E_ILLEGAL_INST;
                 if (inst_xcall) begin
                     edata <= 0;
@@ -887,6 +1538,10 @@ module algol #(
                     edata <= pc;
                     ecode <= E_BREAKPOINT;
                 end
+                if (target_unaligned) begin
+                    edata <= {add_out[31:1], 1'b0};
+                    ecode <= E_INST_ADDR_MISALIGNED;
+                end
                 if (interrupt) begin
                     edata <= instruction;
                     case (1'b1)
@@ -898,18 +1553,10 @@ module algol #(
             end
             cpu_state_mem: begin
                 edata <= add_out;
-                if (is_s && mem_error)     ecode <= E_STORE_AMO_ACCESS_FAULT;
-                if (is_s && mem_unaligned) ecode <= E_STORE_AMO_ADDR_MISALIGNED;
-                if (is_l && mem_error)     ecode <= E_LOAD_ACCESS_FAULT;
-                if (is_l && mem_unaligned) ecode <= E_LOAD_ADDR_MISALIGNED;
-            end
-            cpu_state_csr: begin
-                edata <= instruction;
-                ecode <= E_ILLEGAL_INST;
-            end
-            default: begin
-                edata <= {add_out[31:1], 1'b0};
-                ecode <= E_INST_ADDR_MISALIGNED;
+                if ((is_s || is_amo) && mem_error)                   ecode <= E_STORE_AMO_ACCESS_FAULT;
+                if ((is_s || is_amo) && mem_unaligned && !ma_access) ecode <= E_STORE_AMO_ADDR_MISALIGNED;
+                if (is_l && mem_error)                               ecode <= E_LOAD_ACCESS_FAULT;
+                if (is_l && mem_unaligned && !ma_access)             ecode <= E_LOAD_ADDR_MISALIGNED;
             end
         endcase
     end
@@ -933,8 +1580,6 @@ module algol #(
             if (cpu_state == cpu_state_fetch)   cpu_state_ok = 1;
             if (cpu_state == cpu_state_execute) cpu_state_ok = 1;
             if (cpu_state == cpu_state_mem)     cpu_state_ok = 1;
-            if (cpu_state == cpu_state_csr)     cpu_state_ok = 1;
-            if (cpu_state == cpu_state_wb)      cpu_state_ok = 1;
             if (cpu_state == cpu_state_trap)    cpu_state_ok = 1;
             assert (cpu_state_ok);
         end
@@ -942,7 +1587,7 @@ module algol #(
     // ---------------------------------------------------------------------
     // PC always aligned
     always @(posedge clk) begin
-        if (!rst) assert(pc[1:0] == 0);
+        if (!rst) assert(pc[0] == 0 && (ENABLE_RV32C || pc[1] == 0));
     end
     // ---------------------------------------------------------------------
     // verify memory port
@@ -953,18 +1598,20 @@ module algol #(
                 cpu_state_fetch: begin
                     assume(!mem_ready);
                     assume(!mem_error);
-                    assert(mem_address[1:0] == 0); // always aligned
-                    assert(mem_valid == 1);
+                    assert(if_address[1:0] == 0); // always aligned
+                    assert(if_valid == (pf_req || (!pf_valid && fetch_bus)));
+                    if (ENABLE_HARVARD) assert(!mem_valid);
                 end
                 cpu_state_mem: begin
                     assume(!mem_ready);
                     assume(!mem_error);
+                    if (!ENABLE_HARVARD) assert(!pf_req);  // the prefetch never uses the port in this state
                     if (is_s) assert(|mem_wsel);
                     if (is_l) assert(mem_wsel == 0);
-                    assert(mem_valid == mem_enable); // FIXME mem_enable is not defined
+                    assert(mem_valid == ((!mem_unaligned || ma_access) && !sc_skip));
                 end
                 default: begin
-                    assert(mem_valid == 0);
+                    assert(mem_valid == (pf_req && !ENABLE_HARVARD));
                 end
             endcase
         end
@@ -977,10 +1624,14 @@ module algol #(
             assert(!mem_valid);
         end
     end
-    // check end of transaction
+    // check pending transaction: signals are stable until ready/error.
+    // A new transaction can start right after the end of the previous one (prefetch).
     always @(posedge clk) begin
-        if (fv_valid && $past(mem_ready) && $past(mem_valid)) assert(!mem_valid);
-        if (fv_valid && $past(mem_error) && $past(mem_valid)) assert(!mem_valid);
+        if (fv_valid && !$past(rst) && $past(mem_valid) && !$past(mem_ready) && !$past(mem_error)) begin
+            assert(mem_valid);
+            assert(mem_address == $past(mem_address));
+            assert(mem_wsel == $past(mem_wsel));
+        end
     end
     // error and ready must not be high at the same time
     always @(*) begin
@@ -1011,92 +1662,227 @@ module algol #(
 `endif
     // =====================================================================
     // unused signals: remove verilator warnings about unused signal
-    wire _unused = &{dbg_ascii_state};
+    wire _unused = &{dbg_ascii_state, snoop_address[1:0]};
     // =====================================================================
 endmodule
 
-module algol_multiplier (
-                          input wire        clk,
-                          input wire        rst,
-                          input wire [31:0] mult_op1,
-                          input wire [31:0] mult_op2,
-                          input wire [1:0]  mult_cmd,
-                          input wire        mult_enable,
-                          input wire        mult_abort,
-                          output reg [31:0] mult_result,
-                          output reg        mult_ack
-                          );
+module algol_multiplier #(
+                           parameter MULT_LATENCY = 3 // 0, 1, 2, 3 or 32 (sequential)
+                           )(
+                             input wire        clk,
+                             input wire        rst,
+                             input wire [31:0] mult_op1,
+                             input wire [31:0] mult_op2,
+                             input wire [1:0]  mult_cmd,
+                             input wire        mult_enable,
+                             input wire        mult_abort,
+                             output reg [31:0] mult_result,
+                             output reg        mult_ack
+                             );
     //--------------------------------------------------------------------------
-    wire       is_any_mulh;
-    wire       is_op1_signed, is_op2_signed;
-    reg [32:0] op1_q, op2_q;
-    reg [63:0] result;
-    reg [1:0]  active;
+    wire        is_any_mulh;
+    wire        is_op1_signed, is_op2_signed;
+    wire [32:0] op1_ext, op2_ext;
+    reg  [63:0] product;                    // last product
+    reg  [32:0] product_op1, product_op2;   // operands of the last product
+    reg         product_valid;
+    reg  [31:0] result_q;
+    reg         ack_q;
+    wire        reuse;
+    wire        start;
+    wire        busy;                       // product of the current instruction in progress
     //
     assign is_any_mulh   = |mult_cmd;
     assign is_op1_signed = mult_cmd[1] ^ mult_cmd[0];
     assign is_op2_signed = mult_cmd == 2'b01;
+    assign op1_ext       = {is_op1_signed && mult_op1[31], mult_op1};
+    assign op2_ext       = {is_op2_signed && mult_op2[31], mult_op2};
+    // Reuse the last product: MULH[[S]U] + MUL with the same operands.
+    // The lower half does not depend on the sign of the operands. Only for a
+    // later instruction: the current one is answered by ack_q and result_q.
+    assign reuse = MULT_LATENCY != 0 && product_valid && !busy &&
+                   (is_any_mulh ? {product_op1, product_op2} == {op1_ext, op2_ext} :
+                                  {product_op1[31:0], product_op2[31:0]} == {mult_op1, mult_op2});
+    assign start = mult_enable && !reuse && !ack_q;
     //
-    always @(posedge clk) begin
-        // verilator lint_off WIDTH
-        if (is_op1_signed) begin
-            op1_q <= $signed(mult_op1);
-        end else begin
-            op1_q <= $unsigned(mult_op1);
-        end
-        //
-        if (is_op2_signed) begin
-            op2_q <= $signed(mult_op2);
-        end else begin
-            op2_q <= $unsigned(mult_op2);
-        end
-        // verilator lint_on WIDTH
-        result      <= $signed(op1_q) * $signed(op2_q);
-        mult_result <= (is_any_mulh) ? result[63:32] : result[31:0];
+    always @(*) begin
+        mult_ack    = ack_q || (mult_enable && reuse);
+        mult_result = result_q;
+        if (reuse) mult_result = is_any_mulh ? product[63:32] : product[31:0];
     end
     //
-    always @(posedge clk or posedge rst) begin
-        if (rst || mult_ack || mult_abort) begin
-            active   <= 0;
-            mult_ack <= 0;
+    generate
+        // other latencies would build a pipeline with a wrong result stage
+        if (MULT_LATENCY != 0 && MULT_LATENCY != 1 && MULT_LATENCY != 2 && MULT_LATENCY != 3 && MULT_LATENCY != 32) begin: gen_mult_latency_error
+            initial $error("algol: MULT_LATENCY must be 0, 1, 2, 3 or 32");
+        end
+        if (MULT_LATENCY == 0) begin
+            // single cycle
+            always @(*) begin
+                product     = $signed(op1_ext) * $signed(op2_ext);
+                result_q    = is_any_mulh ? product[63:32] : product[31:0];
+                ack_q         = mult_enable;
+                product_op1   = op1_ext;
+                product_op2   = op2_ext;
+                product_valid = 0;
+            end
+            assign busy = 0;
+        end else if (MULT_LATENCY == 32) begin
+            // sequential: 1 bit per cycle, using the magnitude of the operands
+            reg [63:0] acc;
+            reg [31:0] op1_abs;
+            reg [5:0]  cnt;
+            reg        running, sign;
+            always @(posedge clk or posedge rst) begin
+                if (rst || ack_q || mult_abort) begin
+                    running <= 0;
+                    ack_q   <= 0;
+                end else begin
+                    if (start && !running) begin
+                        running <= 1;
+                        cnt     <= 0;
+                        // verilator lint_off WIDTH
+                        op1_abs <= op1_ext[32] ? -op1_ext : op1_ext;
+                        acc     <= {32'b0, op2_ext[32] ? -op2_ext[31:0] : op2_ext[31:0]};
+                        // verilator lint_on WIDTH
+                        sign    <= op1_ext[32] ^ op2_ext[32];
+                    end else if (running && cnt != 32) begin
+                        cnt <= cnt + 1;
+                        acc <= {(acc[0] ? {1'b0, acc[63:32]} + {1'b0, op1_abs} : {1'b0, acc[63:32]}), acc[31:1]};
+                    end else if (running) begin
+                        running <= 0;
+                        ack_q   <= 1;
+                    end
+                end
+            end
+            always @(posedge clk or posedge rst) begin
+                if (rst) begin
+                    product_valid <= 0;
+                end else if (running && cnt == 32 && !mult_abort) begin
+                    product_valid <= 1;
+                    product       <= sign ? -acc[63:0] : acc[63:0];
+                    product_op1   <= op1_ext;
+                    product_op2   <= op2_ext;
+                end
+            end
+            always @(*) begin
+                result_q = is_any_mulh ? product[63:32] : product[31:0];
+            end
+            assign busy = running || ack_q;
         end else begin
-            active   <= {active[0], mult_enable};
-            mult_ack <= active[1];
+            // pipelined: operands (latency >= 2) -> product -> result (latency 3)
+            reg [32:0]             op1_q, op2_q;
+            reg [MULT_LATENCY-1:0] active;
+            wire                   product_en;
+            //
+            always @(posedge clk) begin
+                op1_q <= op1_ext;
+                op2_q <= op2_ext;
+            end
+            assign product_en = MULT_LATENCY == 1 ? start : active[0] && !ack_q;
+            always @(posedge clk or posedge rst) begin
+                if (rst) begin
+                    product_valid <= 0;
+                end else if (product_en && !mult_abort) begin
+                    product_valid <= 1;
+                    if (MULT_LATENCY == 1) begin
+                        product     <= $signed(op1_ext) * $signed(op2_ext);
+                        product_op1 <= op1_ext;
+                        product_op2 <= op2_ext;
+                    end else begin
+                        product     <= $signed(op1_q) * $signed(op2_q);
+                        product_op1 <= op1_q;
+                        product_op2 <= op2_q;
+                    end
+                end
+            end
+            if (MULT_LATENCY == 3) begin
+                always @(posedge clk) begin
+                    result_q <= (is_any_mulh) ? product[63:32] : product[31:0];
+                end
+            end else begin
+                always @(*) begin
+                    result_q = (is_any_mulh) ? product[63:32] : product[31:0];
+                end
+            end
+            //
+            always @(posedge clk or posedge rst) begin
+                if (rst || ack_q || mult_abort) begin
+                    active <= 0;
+                end else begin
+                    // verilator lint_off WIDTH
+                    active <= {active, start};
+                    // verilator lint_on WIDTH
+                end
+            end
+            always @(*) begin
+                ack_q = active[MULT_LATENCY-1];
+            end
+            assign busy = |active;
         end
-    end
+    endgenerate
     //--------------------------------------------------------------------------
 endmodule
 
-module algol_divider (
-                       input wire        clk,
-                       input wire        rst,
-                       input wire [31:0] div_op1,
-                       input wire [31:0] div_op2,
-                       input wire [1:0]  div_cmd,
-                       input wire        div_enable,
-                       input wire        div_abort,
-                       output reg [31:0] div_result,
-                       output reg        div_ack
-                       );
+module algol_divider #(
+                        parameter DIV_RADIX = 2 // 2, 4 or 16
+                        )(
+                          input wire        clk,
+                          input wire        rst,
+                          input wire [31:0] div_op1,
+                          input wire [31:0] div_op2,
+                          input wire [1:0]  div_cmd,
+                          input wire        div_enable,
+                          input wire        div_abort,
+                          output reg [31:0] div_result,
+                          output reg        div_ack
+                          );
     //--------------------------------------------------------------------------
-    wire       is_div, is_divu, is_rem;
-    reg [31:0] dividend;
-    reg [62:0] divisor;
-    reg [31:0] quotient;
-    reg [31:0] quotient_mask;
-    reg        start, start_q, running, outsign;
+    localparam K = DIV_RADIX == 16 ? 4 : DIV_RADIX == 4 ? 2 : 1; // quotient bits per cycle
+    // other radixes would silently build a radix-2 divider
+    generate
+        if (DIV_RADIX != 2 && DIV_RADIX != 4 && DIV_RADIX != 16) begin: gen_div_radix_error
+            initial $error("algol: DIV_RADIX must be 2, 4 or 16");
+        end
+    endgenerate
     //
-    assign is_div  = div_cmd == 2'b00;
-    assign is_divu = div_cmd == 2'b01;
-    assign is_rem  = div_cmd == 2'b10;
+    wire        is_div, is_divu, is_rem, is_signed;
+    wire [31:0] op1_abs, op2_abs;
+    wire [5:0]  op1_clz, op2_clz;
+    wire [4:0]  first_bit;
+    reg  [31:0] dividend, dividend_nxt;
+    reg  [K+30:0] divisor, divisor_nxt;
+    reg  [31:0] quotient, quotient_nxt;
+    reg  [31:0] quotient_mask, quotient_mask_nxt;
+    reg         running, outsign;
     //
-    always @(posedge clk or posedge rst) begin
-        if (rst || div_abort) begin
-            start   <= 0;
-            start_q <= 0;
-        end else begin
-            start   <= div_enable && !div_ack;
-            start_q <= start;
+    assign is_div    = div_cmd == 2'b00;
+    assign is_divu   = div_cmd == 2'b01;
+    assign is_rem    = div_cmd == 2'b10;
+    assign is_signed = is_div || is_rem;
+    assign op1_abs   = (is_signed && div_op1[31]) ? -div_op1 : div_op1;
+    assign op2_abs   = (is_signed && div_op2[31]) ? -div_op2 : div_op2;
+    assign op1_clz   = clz(op1_abs);
+    assign op2_clz   = clz(op2_abs);
+    // Early termination: skip the quotient bits above the MSB of the dividend.
+    // Rounded up to a multiple of K.
+    assign first_bit = (op2_clz[4:0] - op1_clz[4:0]) | (K - 1);
+    // K restoring steps per cycle
+    always @(*) begin: div_step
+        integer j;
+        dividend_nxt      = dividend;
+        divisor_nxt       = divisor;
+        quotient_nxt      = quotient;
+        quotient_mask_nxt = quotient_mask;
+        for (j = 0; j < K; j = j + 1) begin
+            // verilator lint_off WIDTH
+            if (divisor_nxt <= dividend_nxt) begin
+                dividend_nxt = dividend_nxt - divisor_nxt;
+                quotient_nxt = quotient_nxt | quotient_mask_nxt;
+            end
+            // verilator lint_on WIDTH
+            divisor_nxt       = divisor_nxt >> 1;
+            quotient_mask_nxt = quotient_mask_nxt >> 1;
         end
     end
     //
@@ -1107,13 +1893,29 @@ module algol_divider (
         end else begin
             div_ack <= 0;
             // verilator lint_off WIDTH
-            if (start && !start_q) begin
-                running       <= 1;
-                dividend      <= ((is_div || is_rem) && div_op1[31]) ? -div_op1 : div_op1;
-                divisor       <= (((is_div || is_rem) && div_op2[31]) ? -div_op2 : div_op2) << 31;
-                outsign       <= (is_div && (div_op1[31] != div_op2[31]) && |div_op2) || (is_rem && div_op1[31]);
-                quotient      <= 0;
-                quotient_mask <= 1 << 31;
+            if (div_enable && !running && !div_ack) begin
+                case (1'b1)
+                    op2_abs == 0: begin // divide by zero
+                        div_ack    <= 1;
+                        div_result <= (is_div || is_divu) ? 32'hffff_ffff : div_op1;
+                    end
+                    op2_abs == 1: begin // divide by 1/-1
+                        div_ack    <= 1;
+                        div_result <= (is_div || is_divu) ? ((is_div && div_op2[31]) ? -div_op1 : div_op1) : 32'b0;
+                    end
+                    op1_clz > op2_clz: begin // |dividend| < |divisor|
+                        div_ack    <= 1;
+                        div_result <= (is_div || is_divu) ? 32'b0 : div_op1;
+                    end
+                    default: begin
+                        running       <= 1;
+                        dividend      <= op1_abs;
+                        divisor       <= op2_abs << first_bit;
+                        outsign       <= (is_div && (div_op1[31] != div_op2[31])) || (is_rem && div_op1[31]);
+                        quotient      <= 0;
+                        quotient_mask <= 1 << first_bit;
+                    end
+                endcase
             end else if (quotient_mask == 0 && running) begin
                 running <= 0;
                 div_ack <= 1;
@@ -1123,16 +1925,24 @@ module algol_divider (
                     div_result <= outsign ? -dividend : dividend;
                 end
             end else begin
-                if (divisor <= dividend) begin
-                    dividend <= dividend - divisor;
-                    quotient <= quotient | quotient_mask;
-                end
-                divisor <= divisor >> 1;
-                quotient_mask <= quotient_mask >> 1;
+                dividend      <= dividend_nxt;
+                divisor       <= divisor_nxt;
+                quotient      <= quotient_nxt;
+                quotient_mask <= quotient_mask_nxt;
             end
             // verilator lint_on WIDTH
         end
     end
+    // count leading zeros
+    function [5:0] clz;
+        input [31:0] value;
+        integer i;
+        begin
+            clz = 32;
+            for (i = 0; i < 32; i = i + 1)
+              if (value[i]) clz = 31 - i;
+        end
+    endfunction
     //--------------------------------------------------------------------------
 endmodule
 
@@ -29,6 +29,7 @@ int CORETB::SimulateCore(const std::string &progfile, const unsigned long max_ti
         m_top->xint_meip = 0;
         m_top->xint_mtip = 0;
         m_top->xint_msip = 0;
+        m_top->snoop_valid = 0;
         // -------------------------------------------------------------
         LoadMemory(progfile);
         m_tohost          = getSymbol(progfile.data(), "tohost");
@@ -43,6 +44,7 @@ int CORETB::SimulateCore(const std::string &progfile, const unsigned long max_ti
                 if (CheckTOHOST(ok))
                         break;
                 CheckInterrupts();
+                CheckStore();
         }
         // -------------------------------------------------------------
         Tick();
@@ -98,6 +100,18 @@ void CORETB::CheckInterrupts() {
         m_top->xint_msip = ram_v_dpi_read_word(XINT_S) != 0;
 }
 // -----------------------------------------------------------------------------
+// Write of another bus master: the core must drop its LR reservation.
+void CORETB::CheckStore() {
+        svSetScope(svGetScopeFromName("TOP.top.memory")); // Set the scope before using DPI functions
+        const uint32_t addr = ram_v_dpi_read_word(XSTORE_A);
+        m_top->snoop_valid   = addr != 0;
+        m_top->snoop_address = addr;
+        if (addr != 0) {
+                ram_v_dpi_write_word(addr, ram_v_dpi_read_word(XSTORE_D));
+                ram_v_dpi_write_word(XSTORE_A, 0);
+        }
+}
+// -----------------------------------------------------------------------------
 void CORETB::SyscallPrint(const uint32_t base_addr) const {
         svSetScope(svGetScopeFromName("TOP.top.memory")); // Set the scope before using DPI functions
         const uint64_t data_addr = ram_v_dpi_read_word(base_addr + 16); // dword 2: offset = 16 bytes.
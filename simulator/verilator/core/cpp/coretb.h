@@ -16,6 +16,7 @@ private:
         uint32_t PrintExitMessage (const bool ok, const unsigned long max_time);
         bool     CheckTOHOST      (bool &ok);
         void     CheckInterrupts  ();
+        void     CheckStore       ();
         void     SyscallPrint     (const uint32_t base_addr) const;
         void     LoadMemory       (const std::string &progfile);
         void     DumpSignature    (const std::string &signature);
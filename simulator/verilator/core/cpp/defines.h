@@ -30,5 +30,8 @@
 #define XINT_S   0x80002000u
 #define XINT_T   0x80002004u
 #define XINT_E   0x80002008u
+// Store of another master (LR/SC test): address, data
+#define XSTORE_A 0x8000200Cu
+#define XSTORE_D 0x80002010u
 
 #endif
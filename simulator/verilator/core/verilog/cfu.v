@@ -0,0 +1,104 @@
+// -----------------------------------------------------------------------------
+// Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+// -----------------------------------------------------------------------------
+// Title       : CFU
+// Project     : Algol
+// Description : Sample custom functional unit (ENABLE_CFU). funct3:
+//               0: CRC-32 byte step (rs1: crc, rs2: data byte). 1 cycle.
+//               1: Q16.16 multiply-accumulate: acc += rs1 * rs2. Return the
+//                  new acc. 2 cycles.
+//               2: Write acc = rs1. Return the old acc. 1 cycle.
+//               3: Interleave the lower 16 bits of rs1 (even) and rs2 (odd).
+//                  1 cycle.
+//               Other: return zero.
+//               The state (acc) is updated when the core takes the result
+//               (cfu_valid && cfu_ready).
+// -----------------------------------------------------------------------------
+
+`default_nettype none
+`timescale 1 ns / 1 ps
+
+module cfu (
+            input wire        clk,
+            input wire        rst,
+            input wire        cfu_valid,
+            input wire [10:0] cfu_funct,
+            input wire [31:0] cfu_op1,
+            input wire [31:0] cfu_op2,
+            output reg [31:0] cfu_result,
+            output reg        cfu_ready
+            );
+    // =====================================================================
+    localparam CRC_POLY = 32'hEDB8_8320; // reflected
+    //
+    reg [31:0] acc;
+    reg [31:0] crc, interleave, result;
+    reg [63:0] product;
+    reg        busy;
+    wire [2:0] funct3;
+    integer    i;
+    //
+    assign funct3 = cfu_funct[2:0];
+    // CRC-32, one byte
+    always @(*) begin
+        crc = cfu_op1 ^ {24'b0, cfu_op2[7:0]};
+        for (i = 0; i < 8; i = i + 1)
+            crc = crc[0] ? (crc >> 1) ^ CRC_POLY : crc >> 1;
+    end
+    // bit interleave
+    always @(*) begin
+        for (i = 0; i < 16; i = i + 1) begin
+            interleave[2*i]     = cfu_op1[i];
+            interleave[2*i + 1] = cfu_op2[i];
+        end
+    end
+    // MAC: first cycle, registered product.
+    always @(posedge clk) begin
+        product <= $signed(cfu_op1) * $signed(cfu_op2);
+    end
+    //
+    always @(*) begin
+        case (funct3)
+            3'd0:    result = crc;
+            3'd1:    result = acc + product[47:16];
+            3'd2:    result = acc;
+            3'd3:    result = interleave;
+            default: result = 32'b0;
+        endcase
+    end
+    // handshake. The MAC takes one extra cycle (busy).
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            cfu_ready <= 0;
+            busy      <= 0;
+        end else begin
+            cfu_ready <= 0;
+            busy      <= 0;
+            if (cfu_valid && !cfu_ready) begin
+                if (funct3 == 3'd1 && !busy) busy      <= 1;
+                else                         cfu_ready <= 1;
+            end
+        end
+    end
+    always @(posedge clk) begin
+        if (cfu_valid && !cfu_ready) cfu_result <= result;
+    end
+    // state
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            acc <= 0;
+        end else if (cfu_valid && cfu_ready) begin
+            case (funct3)
+                3'd1:    acc <= cfu_result;
+                3'd2:    acc <= cfu_op1;
+                default: acc <= acc;
+            endcase
+        end
+    end
+    // =====================================================================
+    // unused signals: remove verilator warnings about unused signal
+    wire _unused = &{cfu_funct[10:3], product[63:48], product[15:0]};
+    // =====================================================================
+endmodule
+`default_nettype wire
+// EOF
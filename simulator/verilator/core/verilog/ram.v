@@ -2,7 +2,8 @@
 // Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
 // -----------------------------------------------------------------------------
 // Title       : RAM
-// Description : Dualport memory
+// Description : Dualport memory. Port B is used by the instruction port of
+//               the core (ENABLE_HARVARD).
 // -----------------------------------------------------------------------------
 
 `default_nettype none
@@ -19,7 +20,15 @@ module ram #(
                input wire        mem_valid,
                output reg [31:0] mem_rdata,
                output reg        mem_ready,
-               output reg        mem_error
+               output reg        mem_error,
+               // port B
+               input wire [31:0] mem_b_address,
+               input wire [31:0] mem_b_wdata,
+               input wire [ 3:0] mem_b_wsel,
+               input wire        mem_b_valid,
+               output reg [31:0] mem_b_rdata,
+               output reg        mem_b_ready,
+               output reg        mem_b_error
                );
     //--------------------------------------------------------------------------
     localparam BYTES = 2**ADDR_WIDTH;
@@ -27,9 +36,13 @@ module ram #(
     byte                    mem[0:BYTES - 1];
     wire [ADDR_WIDTH - 1:0] d_addr;
     wire                    d_access;
+    wire [ADDR_WIDTH - 1:0] b_addr;
+    wire                    b_access;
     // read/write data
     assign d_addr   = {mem_address[ADDR_WIDTH - 1:2], 2'b0};
     assign d_access = mem_address[31:ADDR_WIDTH] == BASE_ADDR[31:ADDR_WIDTH];
+    assign b_addr   = {mem_b_address[ADDR_WIDTH - 1:2], 2'b0};
+    assign b_access = mem_b_address[31:ADDR_WIDTH] == BASE_ADDR[31:ADDR_WIDTH];
     // read
     always @(*) begin
         mem_rdata = 32'hx;
@@ -40,6 +53,15 @@ module ram #(
             mem_rdata[31:24] = mem[d_addr + 3];
         end
     end
+    always @(*) begin
+        mem_b_rdata = 32'hx;
+        if (b_access && mem_b_valid) begin
+            mem_b_rdata[7:0]   = mem[b_addr + 0];
+            mem_b_rdata[15:8]  = mem[b_addr + 1];
+            mem_b_rdata[23:16] = mem[b_addr + 2];
+            mem_b_rdata[31:24] = mem[b_addr + 3];
+        end
+    end
     // write
     always @(posedge clk) begin
         if (d_access && mem_valid) begin
@@ -50,11 +72,19 @@ module ram #(
                 if (mem_wsel[3]) mem[d_addr + 3] <= mem_wdata[24+:8];
             end
         end
+        if (b_access && mem_b_valid) begin
+            if (mem_b_wsel[0]) mem[b_addr + 0] <= mem_b_wdata[0+:8];
+            if (mem_b_wsel[1]) mem[b_addr + 1] <= mem_b_wdata[8+:8];
+            if (mem_b_wsel[2]) mem[b_addr + 2] <= mem_b_wdata[16+:8];
+            if (mem_b_wsel[3]) mem[b_addr + 3] <= mem_b_wdata[24+:8];
+        end
     end
     //
     always @(*) begin
-        mem_ready = mem_valid && d_access; // ready always 1, except for errors.
-        mem_error = mem_valid && !d_access;
+        mem_ready   = mem_valid && d_access; // ready always 1, except for errors.
+        mem_error   = mem_valid && !d_access;
+        mem_b_ready = mem_b_valid && b_access;
+        mem_b_error = mem_b_valid && !b_access;
     end
     //--------------------------------------------------------------------------
     // SystemVerilog DPI functions
@@ -108,6 +138,6 @@ module ram #(
     endfunction
     //--------------------------------------------------------------------------
     // unused signals: remove verilator warnings about unused signal
-    wire _unused = &{mem_address[1:0]};
+    wire _unused = &{mem_address[1:0], mem_b_address[1:0]};
     //--------------------------------------------------------------------------
 endmodule
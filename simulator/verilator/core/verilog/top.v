@@ -10,26 +10,63 @@
 `timescale 1 ns / 1 ps
 
 module top #(
-             parameter [31:0] HART_ID         = 0,
-             parameter [31:0] RESET_ADDR      = 32'h8000_0000,
-             parameter        FAST_SHIFT      = 0,
-             parameter [0:0]  ENABLE_COUNTERS = 1,
-             parameter        ENABLE_RV32M    = 1,
-             parameter [31:0] MEM_SIZE        = 32'h0100_0000
+             parameter [31:0] HART_ID            = 0,
+             parameter [31:0] RESET_ADDR         = 32'h8000_0000,
+             parameter        FAST_SHIFT         = 0,
+             parameter        SHIFT_STEP         = 4,
+             parameter [0:0]  ENABLE_COUNTERS    = 1,
+             parameter        ENABLE_RV32M       = 1,
+             parameter        ENABLE_RV32A       = 1,
+             parameter        ENABLE_RV32C       = 0,
+             parameter        ENABLE_ZB          = 1,
+             parameter        MULT_LATENCY       = 0,
+             parameter        DIV_RADIX          = 4,
+             parameter        ENABLE_PREFETCH    = 1,
+             parameter        ENABLE_HARVARD     = 1,
+             parameter        ENABLE_VECTORED    = 1,
+             parameter        HPM_COUNTERS       = 4,
+             parameter        ENABLE_SHADOW_REGS = 1,
+             parameter        ENABLE_MISALIGNED  = 0,
+             parameter        ENABLE_CFU         = 1,
+             parameter [31:0] MEM_SIZE           = 32'h0100_0000
              )(
                input wire clk,
                input wire rst,
                input wire xint_meip,
                input wire xint_mtip,
-               input wire xint_msip
+               input wire xint_msip,
+               // store of another master (testbench), for the LR reservation
+               input wire snoop_valid,
+               input wire [31:0] snoop_address
                );
     //--------------------------------------------------------------------------
     localparam ADDR_WIDTH = $clog2(MEM_SIZE);
     localparam BASE_ADDR  = RESET_ADDR;
+    // platform timer for the time CSR: free-running, independent of mcycle
+    reg [63:0] xtime;
+    always @(posedge clk or posedge rst) begin
+        if (rst) xtime <= 0;
+        else     xtime <= xtime + 1;
+    end
     /*AUTOWIRE*/
     // Beginning of automatic wires (for undeclared instantiated-module outputs)
+    wire [10:0]         cfu_funct;              // From cpu of algol.v
+    wire [31:0]         cfu_op1;                // From cpu of algol.v
+    wire [31:0]         cfu_op2;                // From cpu of algol.v
+    wire                cfu_ready;              // From accel of cfu.v
+    wire [31:0]         cfu_result;             // From accel of cfu.v
+    wire                cfu_valid;              // From cpu of algol.v
+    wire [31:0]         imem_address;           // From cpu of algol.v
+    wire                imem_error;             // From memory of ram.v
+    wire [31:0]         imem_rdata;             // From memory of ram.v
+    wire                imem_ready;             // From memory of ram.v
+    wire                imem_valid;             // From cpu of algol.v
     wire [31:0]         mem_address;            // From cpu of algol.v
     wire                mem_error;              // From memory of ram.v
+    wire                mem_fence;              // From cpu of algol.v
+    wire                mem_fencei;             // From cpu of algol.v
+    wire                mem_fetch;              // From cpu of algol.v
+    wire                mem_lock;               // From cpu of algol.v
     wire [31:0]         mem_rdata;              // From memory of ram.v
     wire                mem_ready;              // From memory of ram.v
     wire                mem_valid;              // From cpu of algol.v
@@ -39,26 +76,58 @@ module top #(
 
     algol #(/*AUTOINSTPARAM*/
             // Parameters
-            .HART_ID         (HART_ID[31:0]),
-            .RESET_ADDR      (RESET_ADDR[31:0]),
-            .FAST_SHIFT      (FAST_SHIFT),
-            .ENABLE_RV32M    (ENABLE_RV32M),
-            .ENABLE_COUNTERS (ENABLE_COUNTERS)
+            .HART_ID            (HART_ID[31:0]),
+            .RESET_ADDR         (RESET_ADDR[31:0]),
+            .FAST_SHIFT         (FAST_SHIFT),
+            .SHIFT_STEP         (SHIFT_STEP),
+            .ENABLE_RV32M       (ENABLE_RV32M),
+            .ENABLE_RV32A       (ENABLE_RV32A),
+            .ENABLE_RV32C       (ENABLE_RV32C),
+            .ENABLE_ZB          (ENABLE_ZB),
+            .MULT_LATENCY       (MULT_LATENCY),
+            .DIV_RADIX          (DIV_RADIX),
+            .ENABLE_COUNTERS    (ENABLE_COUNTERS),
+            .ENABLE_PREFETCH    (ENABLE_PREFETCH),
+            .ENABLE_HARVARD     (ENABLE_HARVARD),
+            .ENABLE_VECTORED    (ENABLE_VECTORED),
+            .HPM_COUNTERS       (HPM_COUNTERS),
+            .ENABLE_SHADOW_REGS (ENABLE_SHADOW_REGS),
+            .ENABLE_MISALIGNED  (ENABLE_MISALIGNED),
+            .ENABLE_CFU         (ENABLE_CFU)
             ) cpu (/*AUTOINST*/
                    // Outputs
                    .mem_address       (mem_address[31:0]),
                    .mem_wdata         (mem_wdata[31:0]),
                    .mem_wsel          (mem_wsel[3:0]),
                    .mem_valid         (mem_valid),
+                   .mem_fetch         (mem_fetch),
+                   .mem_fencei        (mem_fencei),
+                   .mem_fence         (mem_fence),
+                   .mem_lock          (mem_lock),
+                   .imem_address      (imem_address[31:0]),
+                   .imem_valid        (imem_valid),
+                   .cfu_valid         (cfu_valid),
+                   .cfu_funct         (cfu_funct[10:0]),
+                   .cfu_op1           (cfu_op1[31:0]),
+                   .cfu_op2           (cfu_op2[31:0]),
                    // Inputs
                    .clk               (clk),
                    .rst               (rst),
                    .mem_rdata         (mem_rdata[31:0]),
                    .mem_ready         (mem_ready),
                    .mem_error         (mem_error),
+                   .mem_fence_wait    (1'b0),
+                   .snoop_valid       (snoop_valid),
+                   .snoop_address     (snoop_address[31:0]),
+                   .imem_rdata        (imem_rdata[31:0]),
+                   .imem_ready        (imem_ready),
+                   .imem_error        (imem_error),
+                   .cfu_result        (cfu_result[31:0]),
+                   .cfu_ready         (cfu_ready),
                    .xint_meip         (xint_meip),
                    .xint_mtip         (xint_mtip),
-                   .xint_msip         (xint_msip));
+                   .xint_msip         (xint_msip),
+                   .xtime             (xtime[63:0]));
     //
     ram #(/*AUTOINSTPARAM*/
           // Parameters
@@ -69,12 +138,33 @@ module top #(
                     .mem_rdata         (mem_rdata[31:0]),
                     .mem_ready         (mem_ready),
                     .mem_error         (mem_error),
+                    .mem_b_rdata       (imem_rdata[31:0]),
+                    .mem_b_ready       (imem_ready),
+                    .mem_b_error       (imem_error),
                     // Inputs
                     .clk               (clk),
                     .mem_address       (mem_address[31:0]),
                     .mem_wdata         (mem_wdata[31:0]),
                     .mem_wsel          (mem_wsel[3:0]),
-                    .mem_valid         (mem_valid));
+                    .mem_valid         (mem_valid),
+                    .mem_b_address     (imem_address[31:0]),
+                    .mem_b_wdata       (32'b0),
+                    .mem_b_wsel        (4'b0),
+                    .mem_b_valid       (imem_valid));
+    //
+    cfu accel (/*AUTOINST*/
+               // Outputs
+               .cfu_result            (cfu_result[31:0]),
+               .cfu_ready             (cfu_ready),
+               // Inputs
+               .clk                   (clk),
+               .rst                   (rst),
+               .cfu_valid             (cfu_valid),
+               .cfu_funct             (cfu_funct[10:0]),
+               .cfu_op1               (cfu_op1[31:0]),
+               .cfu_op2               (cfu_op2[31:0]));
+    // unused signals: remove verilator warnings about unused signal
+    wire _unused = &{mem_fetch, mem_fencei, mem_fence, mem_lock};
     //--------------------------------------------------------------------------
 endmodule
 
@@ -21,16 +21,20 @@ void intHandler(int signo){
         signal(SIGINT, SIG_DFL); // just in case...
 }
 // -----------------------------------------------------------------------------
-CORETB::CORETB() : Testbench(TBFREQ, TBTS), m_exitCode(-1) {
+CORETB::CORETB() : Testbench(TBFREQ, TBTS), m_exitCode(-1), m_flash(FLASHSZ) {
         m_mem = reinterpret_cast<uint8_t *>(m_top->algolsoc->ram0->mem);
         m_uartrx = 0;
 }
 // -----------------------------------------------------------------------------
-int CORETB::SimulateCore(const std::string &progfile, const unsigned long max_time, const std::string &s_signature, bool use_uart) {
+int CORETB::SimulateCore(const std::string &progfile, const unsigned long max_time, const std::string &s_signature, bool use_uart,
+                         const std::string &flashfile) {
         bool ok        = false;
         bool notimeout = max_time == 0;
         // -------------------------------------------------------------
-        m_top->uart_rx = 1;
+        m_top->uart_rx    = 1;
+        m_top->flash_io_i = 0;
+        if (!flashfile.empty() && !m_flash.LoadFile(flashfile))
+                exit(EXIT_FAILURE);
         LoadMemory(progfile);
         if (!use_uart) {
                 m_tohost   = getSymbol(progfile.data(), "tohost");
@@ -40,9 +44,12 @@ int CORETB::SimulateCore(const std::string &progfile, const unsigned long max_ti
                 m_begin_signature = getSymbol(progfile.data(), "begin_signature");
                 m_end_signature   = getSymbol(progfile.data(), "end_signature");
         }
+        if (NHARTS > 1)
+                printf(ANSI_COLOR_YELLOW "Harts: %u\n" ANSI_COLOR_RESET, NHARTS);
         Reset();
         while ((getTime() <= max_time || notimeout) && !Verilated::gotFinish() && !quit) {
                 Tick();
+                FlashUpdate();
                 if (use_uart) {
                         UARTRx();
                         if (m_uartrx == 0xff) {
@@ -110,6 +117,12 @@ void CORETB::UARTRx(){
         }
 }
 // -----------------------------------------------------------------------------
+void CORETB::FlashUpdate() {
+        m_top->flash_io_i = m_flash.Update(m_top->flash_sck, m_top->flash_csn, m_top->flash_io_o);
+}
+// -----------------------------------------------------------------------------
+// One tohost (.dword) per hart. Hart 0 ends the simulation, and the other harts
+// fail the test if they have written an error code (0: nothing written).
 bool CORETB::CheckTOHOST(bool &ok) {
         uint32_t addr   = m_tohost - MEMSTART;
         uint32_t tohost = ((uint32_t *)m_mem)[addr >> 2];
@@ -117,6 +130,13 @@ bool CORETB::CheckTOHOST(bool &ok) {
         m_exitCode      = tohost;
         if (tohost == 0)
                 return false;
+        for (uint32_t hart = 1; hart < NHARTS; hart++) {
+                uint32_t code = ((uint32_t *)m_mem)[(addr >> 2) + 2*hart];
+                if (code > 1) {
+                        printf(ANSI_COLOR_RED "Hart %u. Exit code: %08X\n" ANSI_COLOR_RESET, hart, code);
+                        ok = false;
+                }
+        }
         return true;
 }
 // -----------------------------------------------------------------------------
@@ -135,6 +155,8 @@ void CORETB::LoadMemory(const std::string &progfile) {
                 if (start >= MEMSTART && end < MEMSTART + MEMSZ) {
                         uint32_t offset = section[s]->m_start - MEMSTART;
                         std::memcpy(m_mem + offset, section[s]->m_data, section[s]->m_len);
+                } else if (start >= FLASHSTART && end < FLASHSTART + FLASHSZ) {
+                        m_flash.Write(start - FLASHSTART, section[s]->m_data, section[s]->m_len);
                 } else {
                         fprintf(stderr, ANSI_COLOR_MAGENTA "[CORETB] WARNING: unable to fit section %d. Start: 0x%08x, End: 0x%08x\n" ANSI_COLOR_RESET, s, start, end);
                 }
@@ -7,16 +7,19 @@
 
 #include "Valgolsoc.h"
 #include "testbench.h"
+#include "spiflash.h"
 
 class CORETB: public Testbench<Valgolsoc> {
 public:
         CORETB();
-        int SimulateCore(const std::string &progfile, const unsigned long max_time, const std::string &signature, bool use_uart);
+        int SimulateCore(const std::string &progfile, const unsigned long max_time, const std::string &signature, bool use_uart,
+                         const std::string &flashfile);
 private:
         uint32_t PrintExitMessage (const bool ok, const unsigned long max_time);
         void     LoadMemory       (const std::string &progfile);
         void     DumpSignature    (const std::string &signature);
         void     UARTRx           ();
+        void     FlashUpdate      ();
         bool     CheckTOHOST      (bool &ok);
         //
         uint32_t m_exitCode;
@@ -26,6 +29,7 @@ private:
         uint32_t m_end_signature;
         uint8_t *m_mem;
         uint8_t  m_uartrx;
+        SPIFLASH m_flash;
 };
 
 #endif
@@ -19,11 +19,19 @@
 #define ANSI_COLOR_RESET   "\x1b[0m"
 // -----------------------------------------------------------------------------
 // Fixed parameters from ALGOLSOC.v
-#define TBFREQ   100e6
-#define TBTS     1e-9
-#define MEMSTART 0x10000000u    // Initial address
-#define MEMSZ    0x00008000u    // size: 32 KB
-#define BAUDRATE 1000000
+#define TBFREQ     100e6
+#define TBTS       1e-9
+#define MEMSTART   0x10000000u    // Initial address
+#define MEMSZ      0x00008000u    // size: 32 KB
+#define FLASHSTART 0x40000000u    // XIP flash (FLASH_BASE)
+#define FLASHSZ    0x01000000u    // size: 16 MB (FLASH_AW)
+#define BAUDRATE   1000000
+#ifndef NHARTS
+#define NHARTS     1u             // NHARTS (makefile)
+#endif
+#if NHARTS > 8
+#error "tohost: up to 8 harts (fromhost is 64 bytes after tohost)"
+#endif
 // -----------------------------------------------------------------------------
 // syscall (benchmarks)
 #define SYSCALL  64
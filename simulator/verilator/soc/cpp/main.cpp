@@ -11,7 +11,7 @@
 void printHelp() {
         printf("RISC-V CPU Verilator model.\n");
         printf("Usage:\n");
-        printf("\t" EXE ".exe --file <ELF file> [--timeout <max time>] [--signature <signature file>] [--trace]\n");
+        printf("\t" EXE ".exe --file <ELF file> [--timeout <max time>] [--signature <signature file>] [--flash <image>] [--use-uart] [--trace]\n");
         printf("\t" EXE ".exe --help\n");
 }
 
@@ -22,6 +22,7 @@ int main(int argc, char **argv) {
         const std::string &s_progfile  = input.GetCmdOption("--file");
         const std::string &s_timeout   = input.GetCmdOption("--timeout");
         const std::string &s_signature = input.GetCmdOption("--signature");
+        const std::string &s_flash     = input.GetCmdOption("--flash");
         const bool         use_uart    = input.CmdOptionExist("--use-uart");
         const bool         trace       = input.CmdOptionExist("--trace");
         // help
@@ -53,7 +54,7 @@ int main(int argc, char **argv) {
                 printf("[CORETB] Trace file in build folder\n");
                 tb->OpenTrace(vcdFile);
         }
-        int exitCode = tb->SimulateCore(s_progfile, timeout, s_signature, use_uart);
+        int exitCode = tb->SimulateCore(s_progfile, timeout, s_signature, use_uart, s_flash);
         delete tb;
         return exitCode;
 }
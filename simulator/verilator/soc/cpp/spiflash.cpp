@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+ */
+
+#include <cstdio>
+#include <cstring>
+#include "spiflash.h"
+#include "defines.h"
+
+// -----------------------------------------------------------------------------
+SPIFLASH::SPIFLASH(uint32_t size) : m_mem(size, 0xff), m_state(S_CMD), m_quad(false), m_cont(false),
+                                    m_sck(0), m_io(0), m_shift(0), m_bits(0), m_addr(0) {
+}
+// -----------------------------------------------------------------------------
+bool SPIFLASH::LoadFile(const std::string &filename) {
+        FILE *fp = fopen(filename.data(), "rb");
+        if (fp == NULL) {
+                fprintf(stderr, ANSI_COLOR_RED "[SPIFLASH] Unable to open the image: %s\n" ANSI_COLOR_RESET, filename.data());
+                return false;
+        }
+        size_t n = fread(m_mem.data(), 1, m_mem.size(), fp);
+        if (fgetc(fp) != EOF)
+                fprintf(stderr, ANSI_COLOR_MAGENTA "[SPIFLASH] WARNING: image truncated to %zu bytes\n" ANSI_COLOR_RESET, n);
+        fclose(fp);
+        printf(ANSI_COLOR_YELLOW "Flash image: %s (%zu bytes)\n" ANSI_COLOR_RESET, filename.c_str(), n);
+        return true;
+}
+// -----------------------------------------------------------------------------
+void SPIFLASH::Write(uint32_t offset, const char *data, uint32_t len) {
+        std::memcpy(m_mem.data() + offset, data, len);
+}
+// -----------------------------------------------------------------------------
+// Call after each clock edge of the SoC. Returns the value of the IO pins
+// driven by the flash. Inputs are sampled at the rising edge of SCK, and the
+// outputs change at the falling edge (mode 0).
+uint8_t SPIFLASH::Update(uint8_t sck, uint8_t csn, uint8_t io_o) {
+        bool rise = sck && !m_sck;
+        bool fall = !sck && m_sck;
+        m_sck     = sck;
+        if (csn) {
+                // end of transfer. In continuous read mode, the next transfer
+                // starts with the address.
+                m_state = m_cont ? S_ADDR : S_CMD;
+                m_quad  = m_cont;
+                m_shift = 0;
+                m_bits  = 0;
+                return m_io;
+        }
+        if (rise) {
+                switch (m_state) {
+                case S_CMD:
+                        m_shift = (m_shift << 1) | (io_o & 1);
+                        if (++m_bits == 8) {
+                                m_quad  = m_shift == 0xeb;
+                                m_state = (m_shift == 0x03 || m_shift == 0xeb) ? S_ADDR : S_NONE;
+                                m_shift = 0;
+                                m_bits  = 0;
+                        }
+                        break;
+                case S_ADDR:
+                        m_shift = m_quad ? (m_shift << 4) | (io_o & 0xf) : (m_shift << 1) | (io_o & 1);
+                        m_bits += m_quad ? 4 : 1;
+                        if (m_bits == 24) {
+                                m_addr  = m_shift % m_mem.size();
+                                m_state = m_quad ? S_MODE : S_DATA;
+                                m_shift = 0;
+                                m_bits  = 0;
+                        }
+                        break;
+                case S_MODE:
+                        m_shift = (m_shift << 4) | (io_o & 0xf);
+                        m_bits += 4;
+                        if (m_bits == 8) {
+                                m_cont  = (m_shift & 0x30) == 0x20;
+                                m_state = S_DUMMY;
+                                m_bits  = 0;
+                        }
+                        break;
+                case S_DUMMY:
+                        if (++m_bits == 4) {
+                                m_state = S_DATA;
+                                m_bits  = 0;
+                        }
+                        break;
+                default:
+                        break;
+                }
+        } else if (fall && m_state == S_DATA) {
+                // MSB first
+                uint8_t byte = m_mem[m_addr];
+                if (m_quad) {
+                        m_io    = m_bits == 0 ? byte >> 4 : byte & 0xf;
+                        m_bits += 4;
+                } else {
+                        m_io    = ((byte >> (7 - m_bits)) & 1) << 1; // IO1: MISO
+                        m_bits += 1;
+                }
+                if (m_bits == 8) {
+                        m_bits = 0;
+                        m_addr = (m_addr + 1) % m_mem.size();
+                }
+        }
+        return m_io;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+ */
+
+// File: spiflash.h
+// Behavioral SPI flash. Commands: read (03h), and quad I/O read (EBh) with
+// continuous read mode. The contents are loaded from a host file (raw
+// binary) and/or ELF sections.
+
+#ifndef SPIFLASH_H
+#define SPIFLASH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class SPIFLASH {
+public:
+        SPIFLASH(uint32_t size);
+        bool    LoadFile (const std::string &filename);
+        void    Write    (uint32_t offset, const char *data, uint32_t len);
+        uint8_t Update   (uint8_t sck, uint8_t csn, uint8_t io_o);
+private:
+        enum State {S_CMD, S_ADDR, S_MODE, S_DUMMY, S_DATA, S_NONE};
+        //
+        std::vector<uint8_t> m_mem;
+        State    m_state;
+        bool     m_quad;
+        bool     m_cont;
+        uint8_t  m_sck;
+        uint8_t  m_io;
+        uint32_t m_shift;
+        uint32_t m_bits;
+        uint32_t m_addr;
+};
+
+#endif
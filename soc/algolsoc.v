@@ -10,30 +10,109 @@
 `timescale 1 ns / 1 ps
 
 module algolsoc #(
-                  parameter [31:0] RESET_ADDR      = 32'h0000_0000,
-                  parameter        FAST_SHIFT      = 1,
-                  parameter        ENABLE_COUNTERS = 1,
-                  parameter        ENABLE_RV32M    = 1,
-                  parameter        RAM_AW          = 15,
-                  parameter        ROM_AW          = 8,
-                  parameter        BOOTLOADER      = "bootloader.hex"
+                  parameter        NHARTS             = 1, // 1 to 8
+                  parameter [31:0] RESET_ADDR         = 32'h0000_0000,
+                  parameter        FAST_SHIFT         = 1,
+                  parameter        SHIFT_STEP         = 4,
+                  parameter        ENABLE_COUNTERS    = 1,
+                  parameter        ENABLE_RV32M       = 1,
+                  parameter        ENABLE_RV32A       = 1,
+                  parameter        ENABLE_RV32C       = 0,
+                  parameter        ENABLE_ZB          = 1,
+                  parameter        MULT_LATENCY       = 2,
+                  parameter        DIV_RADIX          = 4,
+                  parameter        ENABLE_PREFETCH    = 1,
+                  parameter        ENABLE_HARVARD     = 1,
+                  parameter        ENABLE_VECTORED    = 1,
+                  parameter        HPM_COUNTERS       = 4,
+                  parameter        ENABLE_SHADOW_REGS = 1,
+                  parameter        ENABLE_MISALIGNED  = 0,
+                  parameter        ENABLE_ICACHE      = 1,
+                  parameter        ICACHE_WAYS        = 1,
+                  parameter        ICACHE_LINES       = 64,
+                  parameter        ICACHE_LINE_WORDS  = 4,
+                  parameter        ENABLE_STORE_BUF   = 1,
+                  parameter        STORE_BUF_DEPTH    = 4,
+                  parameter        BUS_REG_DECODE     = 1,
+                  parameter        ENABLE_DMA         = 1,
+                  parameter        UART_TX_DEPTH      = 16,
+                  parameter        UART_RX_DEPTH      = 16,
+                  parameter        ENABLE_TCM         = 1,
+                  parameter [31:0] TCM_BASE           = 32'h3000_0000,
+                  parameter        TCM_AW             = 12,
+                  parameter        ENABLE_FLASH       = 1,
+                  parameter [31:0] FLASH_BASE         = 32'h4000_0000,
+                  parameter        FLASH_AW           = 24,
+                  parameter        FLASH_LINE_WORDS   = 8,
+                  parameter        FLASH_QUAD         = 1,
+                  parameter        RAM_AW             = 15,
+                  parameter        ROM_AW             = 8,
+                  parameter        BOOTLOADER         = "bootloader.hex"
                   )(
                     input wire  clk,
                     input wire  rst,
-                    output wire uart_tx,
-                    input wire  uart_rx
+                    output wire       uart_tx,
+                    input wire        uart_rx,
+                    // SPI flash
+                    output wire       flash_sck,
+                    output wire       flash_csn,
+                    output wire [3:0] flash_io_o,
+                    output wire [3:0] flash_io_oe,
+                    input wire [3:0]  flash_io_i
                     );
     // =====================================================================
     wire        rst_sync;
-    wire        xint_mtip;
+    wire [NHARTS-1:0] xint_mtip;
+    wire [NHARTS-1:0] xint_msip;
+    wire [63:0]       xtime;
+    wire        xint_meip;
+    wire        dma_irq;
+    wire        uart_irq;
+    wire        uart_rx_dreq;
+    wire        uart_tx_dreq;
+    //
     wire [31:0] master_address;
     wire [31:0] master_wdata;
     wire [3:0]  master_wsel;
     wire        master_valid;
+    wire        master_stall;
     wire [31:0] master_rdata;
     wire        master_ready;
     wire        master_error;
     //
+    wire [31:0] imaster_address;
+    wire [2:0]  imaster_burst;
+    wire        imaster_valid;
+    wire        imaster_stall;
+    wire [31:0] imaster_rdata;
+    wire        imaster_ready;
+    wire        imaster_error;
+    //
+    wire [NHARTS*32-1:0] hart_address;
+    wire [NHARTS*32-1:0] hart_wdata;
+    wire [NHARTS*4-1:0]  hart_wsel;
+    wire [NHARTS-1:0]    hart_valid;
+    wire [NHARTS-1:0]    hart_lock;
+    wire [NHARTS*32-1:0] hart_rdata;
+    wire [NHARTS-1:0]    hart_ready;
+    wire [NHARTS-1:0]    hart_error;
+    wire [NHARTS*32-1:0] hart_iaddress;
+    wire [NHARTS*3-1:0]  hart_iburst;
+    wire [NHARTS-1:0]    hart_ivalid;
+    wire [NHARTS*32-1:0] hart_irdata;
+    wire [NHARTS-1:0]    hart_iready;
+    wire [NHARTS-1:0]    hart_ierror;
+    //
+    wire [31:0] dmaster_address;
+    wire [31:0] dmaster_wdata;
+    wire [3:0]  dmaster_wsel;
+    wire [2:0]  dmaster_burst;
+    wire        dmaster_valid;
+    wire        dmaster_stall;
+    wire [31:0] dmaster_rdata;
+    wire        dmaster_ready;
+    wire        dmaster_error;
+    //
     wire [31:0] slave_address;
     wire [31:0] slave_wdata;
     wire [3:0]  slave_wsel;
@@ -53,6 +132,27 @@ module algolsoc #(
     wire [31:0] slave3_rdata;
     wire        slave3_ready;
     wire        slave3_error;
+    wire        slave4_valid;
+    wire [31:0] slave4_rdata;
+    wire        slave4_ready;
+    wire        slave4_error;
+    wire        slave5_valid;
+    wire [31:0] slave5_rdata;
+    wire        slave5_ready;
+    wire        slave5_error;
+    wire        slave6_valid;
+    wire [31:0] slave6_rdata;
+    wire        slave6_ready;
+    wire        slave6_error;
+    wire [31:0] slave_b_address;
+    wire [31:0] slave_b_wdata;
+    wire [3:0]  slave_b_wsel;
+    wire        slave1_b_valid;
+    wire [31:0] slave1_b_rdata;
+    wire        slave1_b_ready;
+    wire        slave1_b_error;
+    wire        _b0_valid, _b2_valid, _b3_valid, _b4_valid, _b5_valid, _b6_valid; // single-port slaves
+    wire        bus_snoop;  // write granted on port A (any master)
 
     rst_generator rst_gen (// Outputs
                            .rst_sync  (rst_sync),
@@ -61,50 +161,185 @@ module algolsoc #(
                            .rst_async (rst)
                            );
 
-    algol #(// Parameters
-            .HART_ID         (0),
-            .RESET_ADDR      (RESET_ADDR),
-            .FAST_SHIFT      (FAST_SHIFT),
-            .ENABLE_RV32M    (ENABLE_RV32M),
-            .ENABLE_COUNTERS (ENABLE_COUNTERS)
-            ) algol0 (// Outputs
-                      .mem_address (master_address[31:0]),
-                      .mem_wdata   (master_wdata[31:0]  ),
-                      .mem_wsel    (master_wsel[3:0]    ),
-                      .mem_valid   (master_valid        ),
-                      // Inputs
-                      .clk         (clk                 ),
-                      .rst         (rst_sync            ),
-                      .mem_rdata   (master_rdata[31:0]  ),
-                      .mem_ready   (master_ready        ),
-                      .mem_error   (master_error        ),
-                      .xint_meip   (0                   ),
-                      .xint_mtip   (xint_mtip           ),
-                      .xint_msip   (0                   )
-                      );
+    // Harts. Hart 0 gets the external interrupt (PLIC). With more than one
+    // hart, the data and instruction masters are merged by round-robin
+    // arbiters.
+    generate
+        if (NHARTS < 1 || NHARTS > 8) begin: gen_nharts_error
+            initial $error("algolsoc: NHARTS must be 1 to 8");
+        end
+        genvar h;
+        for (h = 0; h < NHARTS; h = h + 1) begin: gen_hart
+            hart #(// Parameters
+                   .HART_ID            (h),
+                   .RESET_ADDR         (RESET_ADDR),
+                   .FAST_SHIFT         (FAST_SHIFT),
+                   .SHIFT_STEP         (SHIFT_STEP),
+                   .ENABLE_COUNTERS    (ENABLE_COUNTERS),
+                   .ENABLE_RV32M       (ENABLE_RV32M),
+                   .ENABLE_RV32A       (ENABLE_RV32A),
+                   .ENABLE_RV32C       (ENABLE_RV32C),
+                   .ENABLE_ZB          (ENABLE_ZB),
+                   .MULT_LATENCY       (MULT_LATENCY),
+                   .DIV_RADIX          (DIV_RADIX),
+                   .ENABLE_PREFETCH    (ENABLE_PREFETCH),
+                   .ENABLE_HARVARD     (ENABLE_HARVARD),
+                   .ENABLE_VECTORED    (ENABLE_VECTORED),
+                   .HPM_COUNTERS       (HPM_COUNTERS),
+                   .ENABLE_SHADOW_REGS (ENABLE_SHADOW_REGS),
+                   .ENABLE_MISALIGNED  (ENABLE_MISALIGNED),
+                   .ENABLE_ICACHE      (ENABLE_ICACHE),
+                   .ICACHE_WAYS        (ICACHE_WAYS),
+                   .ICACHE_LINES       (ICACHE_LINES),
+                   .ICACHE_LINE_WORDS  (ICACHE_LINE_WORDS),
+                   .ENABLE_STORE_BUF   (ENABLE_STORE_BUF),
+                   .STORE_BUF_DEPTH    (STORE_BUF_DEPTH),
+                   .ENABLE_TCM         (ENABLE_TCM),
+                   .TCM_BASE           (TCM_BASE),
+                   .TCM_AW             (TCM_AW)
+                   ) hart0 (// Outputs
+                            .master_address  (hart_address[h*32+:32] ),
+                            .master_wdata    (hart_wdata[h*32+:32]   ),
+                            .master_wsel     (hart_wsel[h*4+:4]      ),
+                            .master_valid    (hart_valid[h]          ),
+                            .master_lock     (hart_lock[h]           ),
+                            .imaster_address (hart_iaddress[h*32+:32]),
+                            .imaster_burst   (hart_iburst[h*3+:3]    ),
+                            .imaster_valid   (hart_ivalid[h]         ),
+                            // Inputs
+                            .clk             (clk                    ),
+                            .rst             (rst_sync               ),
+                            .master_rdata    (hart_rdata[h*32+:32]   ),
+                            .master_ready    (hart_ready[h]          ),
+                            .master_error    (hart_error[h]          ),
+                            .imaster_rdata   (hart_irdata[h*32+:32]  ),
+                            .imaster_ready   (hart_iready[h]         ),
+                            .imaster_error   (hart_ierror[h]         ),
+                            .xint_meip       (h == 0 && xint_meip    ),
+                            .xint_mtip       (xint_mtip[h]           ),
+                            .xint_msip       (xint_msip[h]           ),
+                            .xtime           (xtime                  ),
+                            .snoop_valid     (bus_snoop              ),
+                            .snoop_address   (slave_address[31:0]    )
+                            );
+        end
+        if (NHARTS == 1) begin: gen_single_hart
+            assign master_address  = hart_address;
+            assign master_wdata    = hart_wdata;
+            assign master_wsel     = hart_wsel;
+            assign master_valid    = hart_valid;
+            assign hart_rdata      = master_rdata;
+            assign hart_ready      = master_ready;
+            assign hart_error      = master_error;
+            assign imaster_address = hart_iaddress;
+            assign imaster_burst   = hart_iburst;
+            assign imaster_valid   = hart_ivalid;
+            assign hart_irdata     = imaster_rdata;
+            assign hart_iready     = imaster_ready;
+            assign hart_ierror     = imaster_error;
+            // unused signals: remove verilator warnings about unused signal
+            wire _unused = &{master_stall, imaster_stall};
+        end else begin: gen_arbiter
+            wire [2:0] _burst;
+            arbiter #(// Parameters
+                      .NPORTS     (NHARTS),
+                      .BURST_BITS (3)
+                      ) arbiter0 (// Outputs
+                                  .master_rdata   (hart_rdata         ),
+                                  .master_ready   (hart_ready         ),
+                                  .master_error   (hart_error         ),
+                                  .bus_address    (master_address     ),
+                                  .bus_wdata      (master_wdata       ),
+                                  .bus_wsel       (master_wsel        ),
+                                  .bus_burst      (_burst             ),
+                                  .bus_valid      (master_valid       ),
+                                  // Inputs
+                                  .clk            (clk                ),
+                                  .rst            (rst_sync           ),
+                                  .master_address (hart_address       ),
+                                  .master_wdata   (hart_wdata         ),
+                                  .master_wsel    (hart_wsel          ),
+                                  .master_burst   ({NHARTS*3{1'b0}}   ),
+                                  .master_valid   (hart_valid         ),
+                                  .master_lock    (hart_lock          ),
+                                  .bus_stall      (master_stall       ),
+                                  .bus_rdata      (master_rdata       ),
+                                  .bus_ready      (master_ready       ),
+                                  .bus_error      (master_error       )
+                                  );
+            arbiter #(// Parameters
+                      .NPORTS     (NHARTS),
+                      .BURST_BITS (3)
+                      ) arbiter1 (// Outputs
+                                  .master_rdata   (hart_irdata        ),
+                                  .master_ready   (hart_iready        ),
+                                  .master_error   (hart_ierror        ),
+                                  .bus_address    (imaster_address    ),
+                                  .bus_wdata      (                   ),
+                                  .bus_wsel       (                   ),
+                                  .bus_burst      (imaster_burst      ),
+                                  .bus_valid      (imaster_valid      ),
+                                  // Inputs
+                                  .clk            (clk                ),
+                                  .rst            (rst_sync           ),
+                                  .master_address (hart_iaddress      ),
+                                  .master_wdata   ({NHARTS*32{1'b0}}  ),
+                                  .master_wsel    ({NHARTS*4{1'b0}}   ),
+                                  .master_burst   (hart_iburst        ),
+                                  .master_valid   (hart_ivalid        ),
+                                  .master_lock    ({NHARTS{1'b0}}     ),
+                                  .bus_stall      (imaster_stall      ),
+                                  .bus_rdata      (imaster_rdata      ),
+                                  .bus_ready      (imaster_ready      ),
+                                  .bus_error      (imaster_error      )
+                                  );
+            // unused signals: remove verilator warnings about unused signal
+            wire _unused = &{_burst};
+        end
+    endgenerate
 
-    mux_switch #(// Parameters
-                 .NSLAVES    (4),
-                 //            3              2              1              0
-                 .BASE_ADDR  ({32'h2001_0000, 32'h2000_0000, 32'h1000_0000, 32'h0000_0000}),
-                 .ADDR_WIDTH ({5'd8,          5'd8,          5'd16,         5'd8})
-                 ) bus0 (// Outputs
-                         .master_rdata   (master_rdata[31:0]                                      ),
-                         .master_ready   (master_ready                                            ),
-                         .master_error   (master_error                                            ),
-                         .slave_address  (slave_address[31:0]                                     ),
-                         .slave_wdata    (slave_wdata[31:0]                                       ),
-                         .slave_wsel     (slave_wsel[3:0]                                         ),
-                         .slave_valid    ({slave3_valid, slave2_valid, slave1_valid, slave0_valid}),
-                         // Inputs
-                         .master_address (master_address[31:0]                                    ),
-                         .master_wdata   (master_wdata[31:0]                                      ),
-                         .master_wsel    (master_wsel[3:0]                                        ),
-                         .master_valid   (master_valid                                            ),
-                         .slave_rdata    ({slave3_rdata, slave2_rdata, slave1_rdata, slave0_rdata}),
-                         .slave_ready    ({slave3_ready, slave2_ready, slave1_ready, slave0_ready}),
-                         .slave_error    ({slave3_error, slave2_error, slave1_error, slave0_error})
-                         );
+    // masters: 0: data, 1: instructions, 2: DMA
+    // The DMA is held while a hart runs an atomic sequence (lock), and the
+    // writes of all masters clear the LR reservations of the harts.
+    assign bus_snoop = |{slave6_valid, slave5_valid, slave4_valid, slave3_valid, slave2_valid, slave1_valid, slave0_valid} && |slave_wsel;
+    crossbar #(// Parameters
+               .NMASTERS   (3),
+               .NSLAVES    (7),
+               //            6              5              4              3              2              1              0
+               .BASE_ADDR  ({FLASH_BASE,    32'h2003_0000, 32'h2002_0000, 32'h2001_0000, 32'h2000_0000, 32'h1000_0000, 32'h0000_0000}),
+               .ADDR_WIDTH ({FLASH_AW[4:0], 5'd8,          5'd8,          5'd8,          5'd8,          5'd16,         5'd8}),
+               .DUAL_PORT  ({1'b0,          1'b0,          1'b0,          1'b0,          1'b0,          1'b1,          1'b0}),
+               .REG_DECODE (BUS_REG_DECODE),
+               .BURST_BITS (3)
+               ) bus0 (// Outputs
+                       .master_stall    ({dmaster_stall, imaster_stall, master_stall}                                                      ),
+                       .master_rdata    ({dmaster_rdata, imaster_rdata, master_rdata}                                                      ),
+                       .master_ready    ({dmaster_ready, imaster_ready, master_ready}                                                      ),
+                       .master_error    ({dmaster_error, imaster_error, master_error}                                                      ),
+                       .slave_address   (slave_address[31:0]                                                                               ),
+                       .slave_wdata     (slave_wdata[31:0]                                                                                 ),
+                       .slave_wsel      (slave_wsel[3:0]                                                                                   ),
+                       .slave_valid     ({slave6_valid, slave5_valid, slave4_valid, slave3_valid, slave2_valid, slave1_valid, slave0_valid}),
+                       .slave_b_address (slave_b_address[31:0]                                                                             ),
+                       .slave_b_wdata   (slave_b_wdata[31:0]                                                                               ),
+                       .slave_b_wsel    (slave_b_wsel[3:0]                                                                                 ),
+                       .slave_b_valid   ({_b6_valid, _b5_valid, _b4_valid, _b3_valid, _b2_valid, slave1_b_valid, _b0_valid}                ),
+                       // Inputs
+                       .clk             (clk                                                                                               ),
+                       .rst             (rst_sync                                                                                          ),
+                       .master_address  ({dmaster_address, imaster_address, master_address}                                                ),
+                       .master_wdata    ({dmaster_wdata, 32'b0, master_wdata}                                                              ),
+                       .master_wsel     ({dmaster_wsel, 4'b0, master_wsel}                                                                 ),
+                       .master_burst    ({dmaster_burst, imaster_burst, 3'b0}                                                              ),
+                       .master_valid    ({dmaster_valid, imaster_valid, master_valid}                                                      ),
+                       .master_hold     ({|hart_lock, 2'b00}                                                                               ),
+                       .slave_rdata     ({slave6_rdata, slave5_rdata, slave4_rdata, slave3_rdata, slave2_rdata, slave1_rdata, slave0_rdata}),
+                       .slave_ready     ({slave6_ready, slave5_ready, slave4_ready, slave3_ready, slave2_ready, slave1_ready, slave0_ready}),
+                       .slave_error     ({slave6_error, slave5_error, slave4_error, slave3_error, slave2_error, slave1_error, slave0_error}),
+                       .slave_b_rdata   ({32'b0, 32'b0, 32'b0, 32'b0, 32'b0, slave1_b_rdata, 32'b0}                                        ),
+                       .slave_b_ready   ({1'b0, 1'b0, 1'b0, 1'b0, 1'b0, slave1_b_ready, 1'b0}                                              ),
+                       .slave_b_error   ({1'b0, 1'b0, 1'b0, 1'b0, 1'b0, slave1_b_error, 1'b0}                                              )
+                       );
 
     bootrom #(// Parameters
               .ROM_AW     (ROM_AW),
@@ -123,46 +358,181 @@ module algolsoc #(
     ram #(// Parameters
           .RAM_AW (RAM_AW)
           ) ram0 (// Outputs
-                  .ram_rdata   (slave1_rdata[31:0] ),
-                  .ram_ready   (slave1_ready       ),
-                  .ram_error   (slave1_error       ),
+                  .ram_rdata     (slave1_rdata[31:0]   ),
+                  .ram_ready     (slave1_ready         ),
+                  .ram_error     (slave1_error         ),
+                  .ram_b_rdata   (slave1_b_rdata[31:0] ),
+                  .ram_b_ready   (slave1_b_ready       ),
+                  .ram_b_error   (slave1_b_error       ),
                   // Inputs
-                  .clk         (clk                ),
-                  .rst         (rst_sync           ),
-                  .ram_address (slave_address[31:0]),
-                  .ram_wdata   (slave_wdata[31:0]  ),
-                  .ram_wsel    (slave_wsel[3:0]    ),
-                  .ram_valid   (slave1_valid       )
+                  .clk           (clk                  ),
+                  .rst           (rst_sync             ),
+                  .ram_address   (slave_address[31:0]  ),
+                  .ram_wdata     (slave_wdata[31:0]    ),
+                  .ram_wsel      (slave_wsel[3:0]      ),
+                  .ram_valid     (slave1_valid         ),
+                  .ram_b_address (slave_b_address[31:0]),
+                  .ram_b_wdata   (slave_b_wdata[31:0]  ),
+                  .ram_b_wsel    (slave_b_wsel[3:0]    ),
+                  .ram_b_valid   (slave1_b_valid       )
                   );
 
-    timer timer0 (// Outputs
-                  .timer_rdata   (slave2_rdata[31:0] ),
-                  .timer_ready   (slave2_ready       ),
-                  .timer_error   (slave2_error       ),
-                  .xint_mtip     (xint_mtip          ),
-                  // Inputs
-                  .clk           (clk                ),
-                  .rst           (rst_sync           ),
-                  .timer_address (slave_address[31:0]),
-                  .timer_wdata   (slave_wdata[31:0]  ),
-                  .timer_wsel    (slave_wsel[3:0]    ),
-                  .timer_valid   (slave2_valid       )
-                  );
+    timer #(// Parameters
+            .NHARTS (NHARTS)
+            ) timer0 (// Outputs
+                      .timer_rdata   (slave2_rdata[31:0] ),
+                      .timer_ready   (slave2_ready       ),
+                      .timer_error   (slave2_error       ),
+                      .xint_mtip     (xint_mtip          ),
+                      .xint_msip     (xint_msip          ),
+                      .xtime         (xtime              ),
+                      // Inputs
+                      .clk           (clk                ),
+                      .rst           (rst_sync           ),
+                      .timer_address (slave_address[31:0]),
+                      .timer_wdata   (slave_wdata[31:0]  ),
+                      .timer_wsel    (slave_wsel[3:0]    ),
+                      .timer_valid   (slave2_valid       )
+                      );
+
+    uart #(// Parameters
+           .TX_DEPTH (UART_TX_DEPTH),
+           .RX_DEPTH (UART_RX_DEPTH)
+           ) uart0 (// Outputs
+                    .uart_rdata   (slave3_rdata[31:0] ),
+                    .uart_ready   (slave3_ready       ),
+                    .uart_error   (slave3_error       ),
+                    .uart_tx      (uart_tx            ),
+                    .uart_rx_dreq (uart_rx_dreq       ),
+                    .uart_tx_dreq (uart_tx_dreq       ),
+                    .uart_irq     (uart_irq           ),
+                    // Inputs
+                    .clk          (clk                ),
+                    .rst          (rst_sync           ),
+                    .uart_address (slave_address[31:0]),
+                    .uart_wdata   (slave_wdata[31:0]  ),
+                    .uart_wsel    (slave_wsel[3:0]    ),
+                    .uart_valid   (slave3_valid       ),
+                    .uart_rx      (uart_rx            )
+                    );
 
-    uart uart0 (// Outputs
-                .uart_rdata   (slave3_rdata[31:0] ),
-                .uart_ready   (slave3_ready       ),
-                .uart_error   (slave3_error       ),
-                .uart_tx      (uart_tx            ),
-                // Inputs
-                .clk          (clk                ),
-                .rst          (rst_sync           ),
-                .uart_address (slave_address[31:0]),
-                .uart_wdata   (slave_wdata[31:0]  ),
-                .uart_wsel    (slave_wsel[3:0]    ),
-                .uart_valid   (slave3_valid       ),
-                .uart_rx      (uart_rx            )
-                );
+    generate
+        if (ENABLE_DMA) begin: gen_dma
+            dma dma0 (// Outputs
+                      .dma_rdata   (slave4_rdata[31:0]   ),
+                      .dma_ready   (slave4_ready         ),
+                      .dma_error   (slave4_error         ),
+                      .mem_address (dmaster_address[31:0]),
+                      .mem_wdata   (dmaster_wdata[31:0]  ),
+                      .mem_wsel    (dmaster_wsel[3:0]    ),
+                      .mem_burst   (dmaster_burst[2:0]   ),
+                      .mem_valid   (dmaster_valid        ),
+                      .dma_irq     (dma_irq              ),
+                      // Inputs
+                      .clk         (clk                  ),
+                      .rst         (rst_sync             ),
+                      .dma_address (slave_address[31:0]  ),
+                      .dma_wdata   (slave_wdata[31:0]    ),
+                      .dma_wsel    (slave_wsel[3:0]      ),
+                      .dma_valid   (slave4_valid         ),
+                      .mem_stall   (dmaster_stall        ),
+                      .mem_rdata   (dmaster_rdata[31:0]  ),
+                      .mem_ready   (dmaster_ready        ),
+                      .mem_error   (dmaster_error        ),
+                      .dreq_rx     (uart_rx_dreq         ),
+                      .dreq_tx     (uart_tx_dreq         )
+                      );
+        end else begin: gen_no_dma
+            // no DMA: accesses to the DMA registers answer with an error
+            reg dma_error;
+            always @(posedge clk or posedge rst_sync) begin
+                if (rst_sync) begin
+                    dma_error <= 0;
+                end else begin
+                    dma_error <= slave4_valid;
+                end
+            end
+            assign slave4_rdata    = 32'b0;
+            assign slave4_ready    = 0;
+            assign slave4_error    = dma_error;
+            assign dmaster_address = 32'b0;
+            assign dmaster_wdata   = 32'b0;
+            assign dmaster_wsel    = 4'b0;
+            assign dmaster_burst   = 3'b0;
+            assign dmaster_valid   = 0;
+            assign dma_irq         = 0;
+            // unused signals: remove verilator warnings about unused signal
+            wire _unused = &{dmaster_stall, dmaster_rdata, dmaster_ready, dmaster_error, uart_rx_dreq, uart_tx_dreq};
+        end
+    endgenerate
+
+    // Execute-in-place SPI flash (read-only): FLASH_BASE, 2^FLASH_AW bytes.
+    generate
+        if (ENABLE_FLASH) begin: gen_flash
+            spiflash #(// Parameters
+                       .FLASH_AW   (FLASH_AW),
+                       .LINE_WORDS (FLASH_LINE_WORDS),
+                       .QUAD       (FLASH_QUAD)
+                       ) flash0 (// Outputs
+                                 .flash_rdata   (slave6_rdata[31:0] ),
+                                 .flash_ready   (slave6_ready       ),
+                                 .flash_error   (slave6_error       ),
+                                 .spi_sck       (flash_sck          ),
+                                 .spi_csn       (flash_csn          ),
+                                 .spi_io_o      (flash_io_o[3:0]    ),
+                                 .spi_io_oe     (flash_io_oe[3:0]   ),
+                                 // Inputs
+                                 .clk           (clk                ),
+                                 .rst           (rst_sync           ),
+                                 .flash_address (slave_address[31:0]),
+                                 .flash_wdata   (slave_wdata[31:0]  ),
+                                 .flash_wsel    (slave_wsel[3:0]    ),
+                                 .flash_valid   (slave6_valid       ),
+                                 .spi_io_i      (flash_io_i[3:0]    )
+                                 );
+        end else begin: gen_no_flash
+            // no flash: accesses answer with an error
+            reg flash_error;
+            always @(posedge clk or posedge rst_sync) begin
+                if (rst_sync) begin
+                    flash_error <= 0;
+                end else begin
+                    flash_error <= slave6_valid;
+                end
+            end
+            assign slave6_rdata = 32'b0;
+            assign slave6_ready = 0;
+            assign slave6_error = flash_error;
+            assign flash_sck    = 0;
+            assign flash_csn    = 1;
+            assign flash_io_o   = 4'b0;
+            assign flash_io_oe  = 4'b0;
+            // unused signals: remove verilator warnings about unused signal
+            wire _unused = &{flash_io_i};
+        end
+    endgenerate
+
+    // interrupt sources: 1: UART, 2: DMA
+    plic #(// Parameters
+           .NSOURCES  (2),
+           .PRIO_BITS (3)
+           ) plic0 (// Outputs
+                    .plic_rdata   (slave5_rdata[31:0] ),
+                    .plic_ready   (slave5_ready       ),
+                    .plic_error   (slave5_error       ),
+                    .xint_meip    (xint_meip          ),
+                    // Inputs
+                    .clk          (clk                ),
+                    .rst          (rst_sync           ),
+                    .plic_address (slave_address[31:0]),
+                    .plic_wdata   (slave_wdata[31:0]  ),
+                    .plic_wsel    (slave_wsel[3:0]    ),
+                    .plic_valid   (slave5_valid       ),
+                    .irq_sources  ({dma_irq, uart_irq})
+                    );
+    // =====================================================================
+    // unused signals: remove verilator warnings about unused signal
+    wire _unused = &{_b0_valid, _b2_valid, _b3_valid, _b4_valid, _b5_valid, _b6_valid};
     // =====================================================================
 endmodule // algolsoc
 `default_nettype wire
@@ -0,0 +1,160 @@
+// -----------------------------------------------------------------------------
+// Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+// -----------------------------------------------------------------------------
+// Title       : Arbiter
+// Project     : AlgolSoC
+// Description : Round-robin arbiter for the pipelined bus. Merges NPORTS
+//               masters (one request or burst in flight each) into one master
+//               port of the crossbar. The requests are registered until they
+//               are granted, and the answers are routed back in order.
+//               After a request with master_lock, only that master is granted
+//               until the lock is released (atomic read-modify-write).
+// -----------------------------------------------------------------------------
+
+`default_nettype none
+`timescale 1 ns / 1 ps
+
+module arbiter #(
+                 parameter NPORTS     = 2, // >= 2
+                 parameter BURST_BITS = 3
+                 )(
+                   input wire                         clk,
+                   input wire                         rst,
+                   // masters
+                   input wire [NPORTS*32-1:0]         master_address,
+                   input wire [NPORTS*32-1:0]         master_wdata,
+                   input wire [NPORTS*4-1:0]          master_wsel,
+                   input wire [NPORTS*BURST_BITS-1:0] master_burst,
+                   input wire [NPORTS-1:0]            master_valid,
+                   input wire [NPORTS-1:0]            master_lock,
+                   output wire [NPORTS*32-1:0]        master_rdata,
+                   output wire [NPORTS-1:0]           master_ready,
+                   output wire [NPORTS-1:0]           master_error,
+                   // bus
+                   output wire [31:0]                 bus_address,
+                   output wire [31:0]                 bus_wdata,
+                   output wire [3:0]                  bus_wsel,
+                   output wire [BURST_BITS-1:0]       bus_burst,
+                   output wire                        bus_valid,
+                   input wire                         bus_stall,
+                   input wire [31:0]                  bus_rdata,
+                   input wire                         bus_ready,
+                   input wire                         bus_error
+                   );
+    // =====================================================================
+    localparam PW = clog2(NPORTS);
+    //
+    // registered requests
+    reg [NPORTS-1:0]     r_valid;
+    reg [31:0]           r_address [0:NPORTS-1];
+    reg [31:0]           r_wdata   [0:NPORTS-1];
+    reg [3:0]            r_wsel    [0:NPORTS-1];
+    reg [BURST_BITS-1:0] r_burst   [0:NPORTS-1];
+    // requests in flight: owner, and number of answers - 1
+    reg [PW-1:0]         q_port    [0:2**PW-1];
+    reg [BURST_BITS-1:0] q_last    [0:2**PW-1];
+    reg [PW:0]           q_head, q_tail;
+    reg [BURST_BITS-1:0] beat;
+    wire                 q_empty, q_full;
+    wire                 answer, issue;
+    //
+    reg [PW-1:0]         last, sel;
+    reg                  locked;
+    reg [PW-1:0]         lock_port;
+    //
+    assign q_empty = q_head == q_tail;
+    assign q_full  = q_head == {~q_tail[PW], q_tail[PW-1:0]};
+    assign answer  = !q_empty && (bus_ready || bus_error);
+    assign issue   = bus_valid && !bus_stall;
+    // round-robin: the first request after the last granted port
+    always @(*) begin: select
+        integer p;
+        reg     found;
+        sel   = 0;
+        found = 0;
+        for (p = NPORTS - 1; p >= 0; p = p - 1) begin
+            if (r_valid[p] && !found) sel = p[PW-1:0];
+            if (r_valid[p] && p > last) begin
+                sel   = p[PW-1:0];
+                found = 1;
+            end
+        end
+        if (locked) sel = lock_port;
+    end
+    // bus port
+    assign bus_address = r_address[sel];
+    assign bus_wdata   = r_wdata[sel];
+    assign bus_wsel    = r_wsel[sel];
+    assign bus_burst   = r_burst[sel];
+    assign bus_valid   = (locked ? r_valid[lock_port] : |r_valid) && !q_full;
+    // answers
+    generate
+        genvar i;
+        for (i = 0; i < NPORTS; i = i + 1) begin:master_out
+            assign master_rdata[i*32+:32] = bus_rdata;
+            assign master_ready[i]        = !q_empty && bus_ready && q_port[q_head[PW-1:0]] == i;
+            assign master_error[i]        = !q_empty && bus_error && q_port[q_head[PW-1:0]] == i;
+        end
+    endgenerate
+    //
+    always @(posedge clk or posedge rst) begin: state
+        integer p;
+        if (rst) begin
+            r_valid <= 0;
+            last    <= 0;
+            q_head  <= 0;
+            q_tail  <= 0;
+            beat    <= 0;
+            locked  <= 0;
+        end else begin
+            for (p = 0; p < NPORTS; p = p + 1) begin
+                if (master_valid[p])                r_valid[p] <= 1;
+                else if (issue && sel == p[PW-1:0]) r_valid[p] <= 0;
+            end
+            if (issue) begin
+                last   <= sel;
+                q_tail <= q_tail + 1;
+            end
+            // lock: from the first locked request, until master_lock is cleared
+            if (locked && !master_lock[lock_port]) locked <= 0;
+            if (issue && master_lock[sel]) begin
+                locked    <= 1;
+                lock_port <= sel;
+            end
+            if (answer) begin
+                beat <= beat + 1;
+                if (beat == q_last[q_head[PW-1:0]]) begin
+                    beat   <= 0;
+                    q_head <= q_head + 1;
+                end
+            end
+        end
+    end
+    always @(posedge clk) begin: requests
+        integer p;
+        for (p = 0; p < NPORTS; p = p + 1) begin
+            if (master_valid[p]) begin
+                r_address[p] <= master_address[p*32+:32];
+                r_wdata[p]   <= master_wdata[p*32+:32];
+                r_wsel[p]    <= master_wsel[p*4+:4];
+                r_burst[p]   <= master_burst[p*BURST_BITS+:BURST_BITS];
+            end
+        end
+        if (issue) begin
+            q_port[q_tail[PW-1:0]] <= sel;
+            q_last[q_tail[PW-1:0]] <= |bus_wsel ? {BURST_BITS{1'b0}} : bus_burst;
+        end
+    end
+    // I hate ISE c:
+    function integer clog2;
+        input integer value;
+        begin
+            value = value - 1;
+            for (clog2 = 0; value > 0; clog2 = clog2 + 1)
+              value = value >> 1;
+        end
+    endfunction
+    // =====================================================================
+endmodule // arbiter
+`default_nettype wire
+// EOF
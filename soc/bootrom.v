@@ -37,8 +37,9 @@ module bootrom #(
     always @(*) begin
         rom_error = 0;
     end
+    // A new request can be accepted every cycle. Answer in the next cycle.
     always @(posedge clk or posedge rst) begin
-        rom_ready <= rom_valid && !rom_ready && !(|rom_address[1:0]);
+        rom_ready <= rom_valid && !(|rom_address[1:0]);
         if (rst) rom_ready <= 0;
     end
     // read
@@ -0,0 +1,290 @@
+// -----------------------------------------------------------------------------
+// Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+// -----------------------------------------------------------------------------
+// Title       : Crossbar
+// Project     : AlgolSoC
+// Description : Multi-master bus switch. Dual-port slaves use the second port
+//               (B) for master 1 (instructions), so it can access them in
+//               parallel with the other masters. Port A is shared by all
+//               masters: lower numbers have priority.
+//               The address decode is registered (REG_DECODE), each master
+//               can have MAX_PENDING requests in flight, and reads can be
+//               bursts. Accesses to unmapped addresses answer with an error.
+//               master_hold keeps a master off the bus (atomic sequences of
+//               other masters).
+// -----------------------------------------------------------------------------
+
+`default_nettype none
+`timescale 1 ns / 1 ps
+
+// Pipelined bus: the master asserts valid for one cycle per request, and
+// slaves accept a request every cycle. The slave answers (ready/error) at
+// least one cycle after the request, in order. The master can issue the next
+// request in the same cycle it receives the answer.
+// stall is asserted while a request is registered and not granted (or the
+// burst is not finished): a new request in that cycle is dropped, and the
+// master must keep it (valid) until stall is low. Masters with one request in
+// flight can ignore stall: they do not issue a new request until the answer,
+// and stall is low by then.
+// Burst: read of burst + 1 consecutive words (one answer per word). Bursts must
+// not cross a slave boundary. Ignored for writes.
+module crossbar #(
+                  parameter                  NMASTERS    = 2, // >= 2
+                  parameter                  NSLAVES     = 4,
+                  parameter [NSLAVES*32-1:0] BASE_ADDR   = 0,
+                  parameter [NSLAVES*5-1:0]  ADDR_WIDTH  = 0,
+                  parameter [NSLAVES-1:0]    DUAL_PORT   = 0, // slaves with a port B
+                  parameter                  REG_DECODE  = 1, // register the address decode
+                  parameter                  MAX_PENDING = 4, // requests in flight per master. Power of 2, >= 2
+                  parameter                  BURST_BITS  = 3  // bursts up to 2**BURST_BITS words
+                  )(
+                    input wire                           clk,
+                    input wire                           rst,
+                    // masters
+                    input wire [NMASTERS*32-1:0]         master_address,
+                    input wire [NMASTERS*32-1:0]         master_wdata,
+                    input wire [NMASTERS*4-1:0]          master_wsel,
+                    input wire [NMASTERS*BURST_BITS-1:0] master_burst,
+                    input wire [NMASTERS-1:0]            master_valid,
+                    input wire [NMASTERS-1:0]            master_hold,
+                    output wire [NMASTERS-1:0]           master_stall,
+                    output wire [NMASTERS*32-1:0]        master_rdata,
+                    output wire [NMASTERS-1:0]           master_ready,
+                    output wire [NMASTERS-1:0]           master_error,
+                    // slaves: port A
+                    output wire [31:0]                   slave_address,
+                    output wire [31:0]                   slave_wdata,
+                    output wire [3:0]                    slave_wsel,
+                    output wire [NSLAVES-1:0]            slave_valid,
+                    input wire [NSLAVES*32-1:0]          slave_rdata,
+                    input wire [NSLAVES-1:0]             slave_ready,
+                    input wire [NSLAVES-1:0]             slave_error,
+                    // slaves: port B (master 1, dual-port slaves)
+                    output wire [31:0]                   slave_b_address,
+                    output wire [31:0]                   slave_b_wdata,
+                    output wire [3:0]                    slave_b_wsel,
+                    output wire [NSLAVES-1:0]            slave_b_valid,
+                    input wire [NSLAVES*32-1:0]          slave_b_rdata,
+                    input wire [NSLAVES-1:0]             slave_b_ready,
+                    input wire [NSLAVES-1:0]             slave_b_error
+                    );
+    // =====================================================================
+    localparam NBITSLAVE = clog2(NSLAVES);
+    localparam MW        = clog2(NMASTERS);
+    localparam PW        = clog2(MAX_PENDING);
+    localparam NM        = NMASTERS;
+    //
+    // master inputs
+    wire [31:0]           in_address [0:NM-1];
+    wire [31:0]           in_wdata   [0:NM-1];
+    wire [3:0]            in_wsel    [0:NM-1];
+    wire [BURST_BITS-1:0] in_burst   [0:NM-1];
+    wire [NSLAVES-1:0]    in_match   [0:NM-1];
+    // request register (decode stage)
+    reg [NM-1:0]          r_valid;
+    reg [31:0]            r_address  [0:NM-1];
+    reg [31:0]            r_wdata    [0:NM-1];
+    reg [3:0]             r_wsel     [0:NM-1];
+    reg [BURST_BITS-1:0]  r_count    [0:NM-1];  // words left - 1
+    reg [NSLAVES-1:0]     r_match    [0:NM-1];
+    // current request: registered, or from the master (!REG_DECODE)
+    reg [NM-1:0]          e_valid, e_derr, e_b, e_last;
+    reg [31:0]            e_address  [0:NM-1];
+    reg [31:0]            e_wdata    [0:NM-1];
+    reg [3:0]             e_wsel     [0:NM-1];
+    reg [NSLAVES-1:0]     e_match    [0:NM-1];
+    reg [NBITSLAVE-1:0]   e_sel      [0:NM-1];
+    // requests in flight: target of each request, in order
+    reg [NBITSLAVE-1:0]   q_sel      [0:NM*MAX_PENDING-1];
+    reg                   q_b        [0:NM*MAX_PENDING-1];
+    reg                   q_derr     [0:NM*MAX_PENDING-1];
+    reg [PW:0]            q_head     [0:NM-1];
+    reg [PW:0]            q_tail     [0:NM-1];
+    reg [NM-1:0]          q_empty, q_full, q_same;
+    reg [NBITSLAVE-1:0]   h_sel      [0:NM-1];
+    reg [NM-1:0]          h_b, h_derr;
+    // port A: owner of the requests in flight
+    reg [PW:0]            a_count    [0:NSLAVES-1];
+    reg [MW-1:0]          a_owner    [0:NSLAVES-1];
+    reg [MW-1:0]          a_master;
+    //
+    reg [NM-1:0]          grant, use_a, stall, answer;
+    reg [NM-1:0]          m_ready, m_error;
+    reg [31:0]            m_rdata    [0:NM-1];
+    // address decode
+    generate
+        genvar i, j;
+        for (j = 0; j < NM; j = j + 1) begin:master_in
+            assign in_address[j] = master_address[j*32+:32];
+            assign in_wdata[j]   = master_wdata[j*32+:32];
+            assign in_wsel[j]    = master_wsel[j*4+:4];
+            assign in_burst[j]   = |master_wsel[j*4+:4] ? {BURST_BITS{1'b0}} : master_burst[j*BURST_BITS+:BURST_BITS];
+            for (i = 0; i < NSLAVES; i = i + 1) begin:addr_match
+                localparam idx = ADDR_WIDTH[i*5+:5];
+                assign in_match[j][i] = in_address[j][31:idx] == BASE_ADDR[i*32+idx+:32-idx];
+            end
+            // masters
+            assign master_stall[j]        = stall[j];
+            assign master_rdata[j*32+:32] = m_rdata[j];
+            assign master_ready[j]        = m_ready[j];
+            assign master_error[j]        = m_error[j];
+        end
+    endgenerate
+    // current request
+    always @(*) begin: current
+        integer m, idx;
+        for (m = 0; m < NM; m = m + 1) begin
+            e_valid[m]   = r_valid[m] || (!REG_DECODE && master_valid[m]);
+            e_address[m] = r_valid[m] ? r_address[m] : in_address[m];
+            e_wdata[m]   = r_valid[m] ? r_wdata[m]   : in_wdata[m];
+            e_wsel[m]    = r_valid[m] ? r_wsel[m]    : in_wsel[m];
+            e_match[m]   = r_valid[m] ? r_match[m]   : in_match[m];
+            e_last[m]    = (r_valid[m] ? r_count[m] : in_burst[m]) == 0;
+            e_derr[m]    = !(|e_match[m]);
+            e_b[m]       = m == 1 && |(e_match[m] & DUAL_PORT);
+            e_sel[m]     = 0;
+            for (idx = 0; idx < NSLAVES; idx = idx + 1) begin
+                if (e_match[m][idx]) e_sel[m] = idx[NBITSLAVE-1:0];
+            end
+        end
+    end
+    // Queue of requests in flight. A master can only have requests in flight
+    // to one target: the answers arrive in order.
+    always @(*) begin: queue
+        integer m;
+        reg [PW:0] last;
+        for (m = 0; m < NM; m = m + 1) begin
+            last       = q_tail[m] - 1;
+            q_empty[m] = q_head[m] == q_tail[m];
+            q_full[m]  = q_head[m] == {~q_tail[m][PW], q_tail[m][PW-1:0]};
+            q_same[m]  = q_empty[m] || ({q_sel[m*MAX_PENDING + last[PW-1:0]], q_b[m*MAX_PENDING + last[PW-1:0]], q_derr[m*MAX_PENDING + last[PW-1:0]]} ==
+                                        {e_derr[m] ? q_sel[m*MAX_PENDING + last[PW-1:0]] : e_sel[m], e_b[m], e_derr[m]});
+            h_sel[m]   = q_sel[m*MAX_PENDING + q_head[m][PW-1:0]];
+            h_b[m]     = q_b[m*MAX_PENDING + q_head[m][PW-1:0]];
+            h_derr[m]  = q_derr[m*MAX_PENDING + q_head[m][PW-1:0]];
+        end
+    end
+    // Arbitration. Port A: one request per cycle, and the requests in flight to
+    // a slave belong to one master (the answers go to the owner).
+    always @(*) begin: arbiter
+        integer m;
+        reg     busy_a;
+        busy_a   = 0;
+        a_master = 0;
+        for (m = 0; m < NM; m = m + 1) begin
+            grant[m] = e_valid[m] && !master_hold[m] && !q_full[m] && q_same[m] &&
+                       (e_derr[m] || e_b[m] || (!busy_a && (a_count[e_sel[m]] == 0 || a_owner[e_sel[m]] == m[MW-1:0])));
+            use_a[m] = grant[m] && !e_derr[m] && !e_b[m];
+            if (use_a[m]) a_master = m[MW-1:0];
+            busy_a   = busy_a || use_a[m];
+            // the master must keep the request
+            stall[m] = r_valid[m] && !(grant[m] && e_last[m]);
+        end
+    end
+    // answers
+    always @(*) begin: answers
+        integer m;
+        for (m = 0; m < NM; m = m + 1) begin
+            case (1'b1)
+                h_derr[m]: begin
+                    m_rdata[m] = 32'bx;
+                    m_ready[m] = 0;
+                    m_error[m] = 1;
+                end
+                h_b[m]: begin
+                    m_rdata[m] = slave_b_rdata[h_sel[m]*32+:32];
+                    m_ready[m] = slave_b_ready[h_sel[m]];
+                    m_error[m] = slave_b_error[h_sel[m]];
+                end
+                default: begin
+                    m_rdata[m] = slave_rdata[h_sel[m]*32+:32];
+                    m_ready[m] = slave_ready[h_sel[m]];
+                    m_error[m] = slave_error[h_sel[m]];
+                end
+            endcase
+            m_ready[m] = m_ready[m] && !q_empty[m];
+            m_error[m] = m_error[m] && !q_empty[m];
+            answer[m]  = m_ready[m] || m_error[m];
+        end
+    end
+    //
+    always @(posedge clk or posedge rst) begin: state
+        integer m, s;
+        if (rst) begin
+            r_valid <= 0;
+            for (m = 0; m < NM; m = m + 1) begin
+                q_head[m] <= 0;
+                q_tail[m] <= 0;
+            end
+            for (s = 0; s < NSLAVES; s = s + 1) begin
+                a_count[s] <= 0;
+                a_owner[s] <= 0;
+            end
+        end else begin
+            for (m = 0; m < NM; m = m + 1) begin
+                // request register
+                if (grant[m] && !e_last[m]) begin
+                    // burst: next word
+                    r_valid[m]   <= 1;
+                    r_address[m] <= e_address[m] + 4;
+                    r_wdata[m]   <= e_wdata[m];
+                    r_wsel[m]    <= e_wsel[m];
+                    r_match[m]   <= e_match[m];
+                    r_count[m]   <= (r_valid[m] ? r_count[m] : in_burst[m]) - 1;
+                end else if (grant[m] || !r_valid[m]) begin
+                    r_valid[m] <= 0;
+                end
+                if (master_valid[m] && !stall[m] && !(grant[m] && !r_valid[m])) begin
+                    r_valid[m]   <= 1;
+                    r_address[m] <= in_address[m];
+                    r_wdata[m]   <= in_wdata[m];
+                    r_wsel[m]    <= in_wsel[m];
+                    r_match[m]   <= in_match[m];
+                    r_count[m]   <= in_burst[m];
+                end
+                // requests in flight
+                if (grant[m]) q_tail[m] <= q_tail[m] + 1;
+                if (answer[m]) q_head[m] <= q_head[m] + 1;
+            end
+            for (s = 0; s < NSLAVES; s = s + 1) begin
+                // verilator lint_off WIDTH
+                a_count[s] <= a_count[s] + slave_valid[s] - (slave_ready[s] || slave_error[s]);
+                // verilator lint_on WIDTH
+                if (slave_valid[s]) a_owner[s] <= a_master;
+            end
+        end
+    end
+    always @(posedge clk) begin: queue_write
+        integer m;
+        for (m = 0; m < NM; m = m + 1) begin
+            if (grant[m]) begin
+                q_sel[m*MAX_PENDING + q_tail[m][PW-1:0]]  <= e_sel[m];
+                q_b[m*MAX_PENDING + q_tail[m][PW-1:0]]    <= e_b[m];
+                q_derr[m*MAX_PENDING + q_tail[m][PW-1:0]] <= e_derr[m];
+            end
+        end
+    end
+    // port A
+    assign slave_address   = e_address[a_master];
+    assign slave_wdata     = e_wdata[a_master];
+    assign slave_wsel      = e_wsel[a_master];
+    assign slave_valid     = e_match[a_master] & {NSLAVES{|use_a}};
+    // port B
+    assign slave_b_address = e_address[1];
+    assign slave_b_wdata   = e_wdata[1];
+    assign slave_b_wsel    = e_wsel[1];
+    assign slave_b_valid   = e_match[1] & DUAL_PORT & {NSLAVES{grant[1] && e_b[1]}};
+
+    // I hate ISE c:
+    function integer clog2;
+        input integer value;
+        begin
+            value = value - 1;
+            for (clog2 = 0; value > 0; clog2 = clog2 + 1)
+              value = value >> 1;
+        end
+    endfunction
+    // =====================================================================
+endmodule // crossbar
+`default_nettype wire
+// EOF
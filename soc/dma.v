@@ -0,0 +1,264 @@
+// -----------------------------------------------------------------------------
+// Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+// -----------------------------------------------------------------------------
+// Title       : DMA
+// Project     : AlgolSoC
+// Description : Single-channel DMA controller. Modes: memory-to-memory copy,
+//               memory fill, peripheral-to-memory (UART Rx) and
+//               memory-to-peripheral (UART Tx). Copies use burst reads of up
+//               to 4 words, and back-to-back writes.
+// -----------------------------------------------------------------------------
+
+`default_nettype none
+`timescale 1 ns / 1 ps
+
+// Registers:
+// 0x00: SRC. Source address. Fill value (fill mode).
+// 0x04: DST. Destination address.
+// 0x08: COUNT. Words (copy, fill) or bytes (peripheral modes) to transfer.
+// 0x0C: CTRL. b0: start (write) / busy (read). b[2:1]: mode. b3: interrupt enable.
+// 0x10: STATUS. b0: busy. b1: done. b2: error. Write 1 to clear done/error.
+// SRC, DST, COUNT and the mode can be written only when the DMA is idle.
+// Copy and fill use word-aligned addresses. Peripheral modes move one byte per
+// request: the peripheral register address (SRC or DST) is fixed.
+module dma (
+            input wire        clk,
+            input wire        rst,
+            // registers
+            input wire [31:0] dma_address,
+            input wire [31:0] dma_wdata,
+            input wire [ 3:0] dma_wsel,
+            input wire        dma_valid,
+            output reg [31:0] dma_rdata,
+            output reg        dma_ready,
+            output reg        dma_error,
+            // memory port (bus master)
+            output reg [31:0] mem_address,
+            output reg [31:0] mem_wdata,
+            output reg [3:0]  mem_wsel,
+            output reg [2:0]  mem_burst,
+            output reg        mem_valid,
+            input wire        mem_stall,
+            input wire [31:0] mem_rdata,
+            input wire        mem_ready,
+            input wire        mem_error,
+            // peripheral requests
+            input wire        dreq_rx,
+            input wire        dreq_tx,
+            //
+            output wire       dma_irq
+            );
+    // =====================================================================
+    localparam MODE_COPY = 2'b00;
+    localparam MODE_FILL = 2'b01;
+    localparam MODE_P2M  = 2'b10;
+    localparam MODE_M2P  = 2'b11;
+    localparam S_IDLE    = 2'b00;
+    localparam S_WAIT    = 2'b01; // start of chunk
+    localparam S_READ    = 2'b10;
+    localparam S_WRITE   = 2'b11;
+    //
+    reg [31:0] src, dst;
+    reg [15:0] count;
+    reg [1:0]  mode;
+    reg        ie, busy, done, fault;
+    reg [1:0]  state;
+    reg [2:0]  chunk, n, iss, ans;
+    reg [31:0] buffer [0:3];
+    reg        err;
+    reg        dreq;
+    reg [7:0]  tx_byte;
+    //
+    wire       write_reg, answer, last;
+    //
+    assign write_reg = dma_valid && (&dma_wsel);
+    assign answer    = mem_ready || mem_error;
+    assign last      = answer && ans == n - 1;
+    assign dma_irq   = ie && done;
+    // words in the next chunk. Bursts do not cross a 16-byte boundary
+    always @(*) begin
+        case (mode)
+            MODE_COPY: chunk = 3'd4 - {1'b0, src[3:2]};
+            MODE_FILL: chunk = 3'd4;
+            default:   chunk = 3'd1;
+        endcase
+        if (count < {13'b0, chunk}) chunk = count[2:0];
+        (* parallel_case *)
+        case (mode)
+            MODE_P2M: dreq = dreq_rx;
+            MODE_M2P: dreq = dreq_tx;
+            default:  dreq = 1;
+        endcase
+        (* parallel_case *)
+        case (src[1:0])
+            2'b00: tx_byte = buffer[0][7:0];
+            2'b01: tx_byte = buffer[0][15:8];
+            2'b10: tx_byte = buffer[0][23:16];
+            2'b11: tx_byte = buffer[0][31:24];
+        endcase
+    end
+    // memory port
+    always @(*) begin
+        mem_address = {src[31:2], 2'b00};
+        mem_wdata   = buffer[iss[1:0]];
+        mem_wsel    = 4'b1111;
+        mem_burst   = n - 1;
+        mem_valid   = 0;
+        case (state)
+            S_READ: begin
+                mem_burst = mode == MODE_COPY ? n - 1 : 3'd0;
+                mem_wsel  = 0;
+                mem_valid = iss == 0;
+            end
+            S_WRITE: begin
+                mem_address = {dst[31:2] + {27'b0, iss}, 2'b00};
+                mem_burst   = 0;
+                mem_valid   = iss != n;
+                (* parallel_case *)
+                case (mode)
+                    MODE_FILL: mem_wdata = src;
+                    MODE_P2M: begin
+                        mem_address = dst;
+                        mem_wdata   = {4{buffer[0][7:0]}};
+                        mem_wsel    = 4'b0001 << dst[1:0];
+                    end
+                    MODE_M2P: begin
+                        mem_address = dst;
+                        mem_wdata   = {24'b0, tx_byte};
+                    end
+                    default: begin
+                    end
+                endcase
+            end
+            default: begin
+            end
+        endcase
+    end
+    // control
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            state <= S_IDLE;
+            mode  <= MODE_COPY;
+            ie    <= 0;
+            busy  <= 0;
+            done  <= 0;
+            fault <= 0;
+        end else begin
+            // registers
+            if (write_reg) begin
+                // verilator lint_off CASEINCOMPLETE
+                case (dma_address[4:2])
+                    3'b000: if (!busy) src   <= dma_wdata;
+                    3'b001: if (!busy) dst   <= dma_wdata;
+                    3'b010: if (!busy) count <= dma_wdata[15:0];
+                    3'b011: begin
+                        ie <= dma_wdata[3];
+                        if (!busy) begin
+                            mode <= dma_wdata[2:1];
+                            if (dma_wdata[0]) begin
+                                busy  <= count != 0;
+                                done  <= count == 0;
+                                fault <= 0;
+                                state <= count != 0 ? S_WAIT : S_IDLE;
+                            end
+                        end
+                    end
+                    3'b100: begin
+                        if (dma_wdata[1]) done  <= 0;
+                        if (dma_wdata[2]) fault <= 0;
+                    end
+                endcase
+                // verilator lint_on CASEINCOMPLETE
+            end
+            // transfer
+            case (state)
+                S_WAIT: begin
+                    if (dreq) begin
+                        n     <= chunk;
+                        iss   <= 0;
+                        ans   <= 0;
+                        err   <= 0;
+                        state <= mode == MODE_FILL ? S_WRITE : S_READ;
+                    end
+                end
+                S_READ: begin
+                    if (mem_valid && !mem_stall) iss <= 1;
+                    if (answer) begin
+                        ans <= ans + 1;
+                        err <= err || mem_error;
+                    end
+                    if (last) begin
+                        iss   <= 0;
+                        ans   <= 0;
+                        state <= S_WRITE;
+                        if (err || mem_error) begin
+                            busy  <= 0;
+                            done  <= 1;
+                            fault <= 1;
+                            state <= S_IDLE;
+                        end
+                    end
+                end
+                S_WRITE: begin
+                    if (mem_valid && !mem_stall) iss <= iss + 1;
+                    if (answer) begin
+                        ans <= ans + 1;
+                        err <= err || mem_error;
+                    end
+                    if (last) begin
+                        count <= count - {13'b0, n};
+                        // verilator lint_off CASEINCOMPLETE
+                        case (mode)
+                            MODE_COPY: begin
+                                src <= src + {27'b0, n, 2'b00};
+                                dst <= dst + {27'b0, n, 2'b00};
+                            end
+                            MODE_FILL: dst <= dst + {27'b0, n, 2'b00};
+                            MODE_P2M:  dst <= dst + 1;
+                            MODE_M2P:  src <= src + 1;
+                        endcase
+                        // verilator lint_on CASEINCOMPLETE
+                        if (err || mem_error || count == {13'b0, n}) begin
+                            busy  <= 0;
+                            done  <= 1;
+                            fault <= err || mem_error;
+                            state <= S_IDLE;
+                        end else begin
+                            state <= S_WAIT;
+                        end
+                    end
+                end
+                default: begin
+                end
+            endcase
+        end
+    end
+    always @(posedge clk) begin
+        if (state == S_READ && mem_ready) buffer[ans[1:0]] <= mem_rdata;
+    end
+    // read
+    always @(posedge clk) begin
+        case (dma_address[4:2])
+            3'b000:  dma_rdata <= src;
+            3'b001:  dma_rdata <= dst;
+            3'b010:  dma_rdata <= {16'b0, count};
+            3'b011:  dma_rdata <= {28'b0, ie, mode, busy};
+            3'b100:  dma_rdata <= {29'b0, fault, done, busy};
+            default: dma_rdata <= 32'bx;
+        endcase
+    end
+    // handshake
+    always @(*) begin
+        dma_error = 0;
+    end
+    always @(posedge clk or posedge rst) begin
+        dma_ready <= dma_valid && !(|dma_address[1:0]);
+        if (rst) dma_ready <= 0;
+    end
+    // =====================================================================
+    // unused signals: remove verilator warnings about unused signal
+    wire _unused = &{dma_address, dma_wdata};
+    // =====================================================================
+endmodule
+`default_nettype wire
+// EOF
@@ -0,0 +1,449 @@
+// -----------------------------------------------------------------------------
+// Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+// -----------------------------------------------------------------------------
+// Title       : Hart
+// Project     : AlgolSoC
+// Description : Algol core, with its TCM, instruction cache and store buffer.
+//               Two bus masters (pipelined protocol, one request in flight):
+//               data (master_*) and instructions (imaster_*, ENABLE_HARVARD).
+//               master_lock is set during atomic read-modify-write accesses:
+//               the bus must not grant other masters. snoop_* are the writes
+//               granted on the bus, to clear the LR reservation.
+// -----------------------------------------------------------------------------
+
+`default_nettype none
+`timescale 1 ns / 1 ps
+
+module hart #(
+              parameter [31:0] HART_ID            = 0,
+              parameter [31:0] RESET_ADDR         = 32'h0000_0000,
+              parameter        FAST_SHIFT         = 1,
+              parameter        SHIFT_STEP         = 4,
+              parameter        ENABLE_COUNTERS    = 1,
+              parameter        ENABLE_RV32M       = 1,
+              parameter        ENABLE_RV32A       = 1,
+              parameter        ENABLE_RV32C       = 0,
+              parameter        ENABLE_ZB          = 1,
+              parameter        MULT_LATENCY       = 2,
+              parameter        DIV_RADIX          = 4,
+              parameter        ENABLE_PREFETCH    = 1,
+              parameter        ENABLE_HARVARD     = 1,
+              parameter        ENABLE_VECTORED    = 1,
+              parameter        HPM_COUNTERS       = 4,
+              parameter        ENABLE_SHADOW_REGS = 1,
+              parameter        ENABLE_MISALIGNED  = 0,
+              parameter        ENABLE_ICACHE      = 1,
+              parameter        ICACHE_WAYS        = 1,
+              parameter        ICACHE_LINES       = 64,
+              parameter        ICACHE_LINE_WORDS  = 4,
+              parameter        ENABLE_STORE_BUF   = 1,
+              parameter        STORE_BUF_DEPTH    = 4,
+              parameter        ENABLE_TCM         = 1,
+              parameter [31:0] TCM_BASE           = 32'h3000_0000,
+              parameter        TCM_AW             = 12
+              )(
+                input wire         clk,
+                input wire         rst,
+                // data master
+                output wire [31:0] master_address,
+                output wire [31:0] master_wdata,
+                output wire [3:0]  master_wsel,
+                output wire        master_valid,
+                output wire        master_lock,
+                input wire [31:0]  master_rdata,
+                input wire         master_ready,
+                input wire         master_error,
+                // writes granted on the bus (all masters): LR reservation
+                input wire         snoop_valid,
+                input wire [31:0]  snoop_address,
+                // instruction master
+                output wire [31:0] imaster_address,
+                output wire [2:0]  imaster_burst,
+                output wire        imaster_valid,
+                input wire [31:0]  imaster_rdata,
+                input wire         imaster_ready,
+                input wire         imaster_error,
+                // interrupts
+                input wire         xint_meip,
+                input wire         xint_mtip,
+                input wire         xint_msip,
+                // platform timer (mtime)
+                input wire [63:0]  xtime
+                );
+    // =====================================================================
+    wire [31:0] core_address;
+    wire [31:0] core_wdata;
+    wire [3:0]  core_wsel;
+    wire        core_valid;
+    wire        core_fetch;
+    wire        core_lock;
+    wire        core_fence;
+    wire        core_fence_wait;
+    wire [31:0] core_rdata;
+    wire        core_ready;
+    wire        core_error;
+    wire [31:0] core_iaddress;
+    wire        core_ivalid;
+    wire [31:0] core_irdata;
+    wire        core_iready;
+    wire        core_ierror;
+    //
+    wire [31:0] cpu_address;
+    wire [31:0] cpu_wdata;
+    wire [3:0]  cpu_wsel;
+    wire        cpu_valid;
+    wire        cpu_fetch;
+    wire        cpu_lock;
+    wire        cpu_fencei;
+    wire [31:0] cpu_rdata;
+    wire        cpu_ready;
+    wire        cpu_error;
+    wire [31:0] cpu_iaddress;
+    wire        cpu_ivalid;
+    wire [31:0] cpu_irdata;
+    wire        cpu_iready;
+    wire        cpu_ierror;
+    //
+    wire [31:0] fe_address;
+    wire [31:0] fe_wdata;
+    wire [3:0]  fe_wsel;
+    wire        fe_valid;
+    wire        fe_fetch;
+    wire [31:0] fe_rdata;
+    wire        fe_ready;
+    wire        fe_error;
+    //
+    wire [31:0] fm_address;
+    wire [31:0] fm_wdata;
+    wire [3:0]  fm_wsel;
+    wire        fm_valid;
+    wire        fm_burst;
+    wire [31:0] fm_rdata;
+    wire        fm_ready;
+    wire        fm_error;
+    //
+    wire [31:0] ic_address;
+    wire [31:0] ic_wdata;
+    wire [3:0]  ic_wsel;
+    wire        ic_valid;
+    wire [31:0] ic_rdata;
+    wire        ic_ready;
+    wire        ic_error;
+    wire        sb_empty;
+    //
+    // No custom functional unit in the SoC.
+    wire        cfu_valid;
+    wire [10:0] cfu_funct;
+    wire [31:0] cfu_op1, cfu_op2;
+    //
+    // FENCE waits until the buffered stores are written: with several harts,
+    // loads must not pass older stores across a fence.
+    assign core_fence_wait = core_fence && !sb_empty;
+    //
+    algol #(// Parameters
+            .HART_ID            (HART_ID),
+            .RESET_ADDR         (RESET_ADDR),
+            .FAST_SHIFT         (FAST_SHIFT),
+            .SHIFT_STEP         (SHIFT_STEP),
+            .ENABLE_RV32M       (ENABLE_RV32M),
+            .ENABLE_RV32A       (ENABLE_RV32A),
+            .ENABLE_RV32C       (ENABLE_RV32C),
+            .ENABLE_ZB          (ENABLE_ZB),
+            .MULT_LATENCY       (MULT_LATENCY),
+            .DIV_RADIX          (DIV_RADIX),
+            .ENABLE_COUNTERS    (ENABLE_COUNTERS),
+            .ENABLE_PREFETCH    (ENABLE_PREFETCH),
+            .ENABLE_HARVARD     (ENABLE_HARVARD),
+            .ENABLE_VECTORED    (ENABLE_VECTORED),
+            .HPM_COUNTERS       (HPM_COUNTERS),
+            .ENABLE_SHADOW_REGS (ENABLE_SHADOW_REGS),
+            .ENABLE_MISALIGNED  (ENABLE_MISALIGNED),
+            .ENABLE_CFU         (0)
+            ) algol0 (// Outputs
+                      .mem_address    (core_address[31:0] ),
+                      .mem_wdata      (core_wdata[31:0]   ),
+                      .mem_wsel       (core_wsel[3:0]     ),
+                      .mem_valid      (core_valid         ),
+                      .mem_fetch      (core_fetch         ),
+                      .mem_fencei     (cpu_fencei         ),
+                      .mem_fence      (core_fence         ),
+                      .mem_lock       (core_lock          ),
+                      .imem_address   (core_iaddress[31:0]),
+                      .imem_valid     (core_ivalid        ),
+                      .cfu_valid      (cfu_valid          ),
+                      .cfu_funct      (cfu_funct[10:0]    ),
+                      .cfu_op1        (cfu_op1[31:0]      ),
+                      .cfu_op2        (cfu_op2[31:0]      ),
+                      // Inputs
+                      .clk            (clk                ),
+                      .rst            (rst                ),
+                      .mem_rdata      (core_rdata[31:0]   ),
+                      .mem_ready      (core_ready         ),
+                      .mem_error      (core_error         ),
+                      .mem_fence_wait (core_fence_wait    ),
+                      .snoop_valid    (snoop_valid        ),
+                      .snoop_address  (snoop_address[31:0]),
+                      .imem_rdata     (core_irdata[31:0]  ),
+                      .imem_ready     (core_iready        ),
+                      .imem_error     (core_ierror        ),
+                      .cfu_result     (32'b0              ),
+                      .cfu_ready      (1'b0               ),
+                      .xint_meip      (xint_meip          ),
+                      .xint_mtip      (xint_mtip          ),
+                      .xint_msip      (xint_msip          ),
+                      .xtime          (xtime              )
+                      );
+
+    // Tightly-coupled memory (ENABLE_TCM): on the ports of the core, in front of
+    // the caches, the store buffer and the bus. Accesses to the TCM range
+    // (TCM_BASE, 2^TCM_AW bytes) are answered in the next cycle, and do not
+    // reach the bus (cpu_*: the rest of the SoC).
+    generate
+        if (ENABLE_TCM) begin: gen_tcm
+            wire [31:0] tcm_rdata, tcm_irdata;
+            wire        tcm_ready, tcm_iready;
+            wire        d_hit, i_hit;
+            //
+            assign d_hit        = core_address[31:TCM_AW] == TCM_BASE[31:TCM_AW];
+            assign i_hit        = core_iaddress[31:TCM_AW] == TCM_BASE[31:TCM_AW];
+            //
+            assign cpu_address  = core_address;
+            assign cpu_wdata    = core_wdata;
+            assign cpu_wsel     = core_wsel;
+            assign cpu_valid    = core_valid && !d_hit;
+            assign cpu_fetch    = core_fetch;
+            assign cpu_lock     = core_lock && !d_hit;
+            assign core_rdata   = d_hit ? tcm_rdata : cpu_rdata;
+            assign core_ready   = d_hit ? tcm_ready : cpu_ready;
+            assign core_error   = !d_hit && cpu_error;
+            assign cpu_iaddress = core_iaddress;
+            assign cpu_ivalid   = core_ivalid && !i_hit;
+            assign core_irdata  = i_hit ? tcm_irdata : cpu_irdata;
+            assign core_iready  = i_hit ? tcm_iready : cpu_iready;
+            assign core_ierror  = !i_hit && cpu_ierror;
+            //
+            tcm #(// Parameters
+                  .TCM_AW (TCM_AW)
+                  ) tcm0 (// Outputs
+                          .tcm_rdata     (tcm_rdata[31:0]     ),
+                          .tcm_ready     (tcm_ready           ),
+                          .tcm_b_rdata   (tcm_irdata[31:0]    ),
+                          .tcm_b_ready   (tcm_iready          ),
+                          // Inputs
+                          .clk           (clk                 ),
+                          .rst           (rst                 ),
+                          .tcm_address   (core_address[31:0]  ),
+                          .tcm_wdata     (core_wdata[31:0]    ),
+                          .tcm_wsel      (core_wsel[3:0]      ),
+                          .tcm_valid     (core_valid && d_hit ),
+                          .tcm_b_address (core_iaddress[31:0] ),
+                          .tcm_b_valid   (core_ivalid && i_hit)
+                          );
+        end else begin: gen_no_tcm
+            assign cpu_address  = core_address;
+            assign cpu_wdata    = core_wdata;
+            assign cpu_wsel     = core_wsel;
+            assign cpu_valid    = core_valid;
+            assign cpu_fetch    = core_fetch;
+            assign cpu_lock     = core_lock;
+            assign core_rdata   = cpu_rdata;
+            assign core_ready   = cpu_ready;
+            assign core_error   = cpu_error;
+            assign cpu_iaddress = core_iaddress;
+            assign cpu_ivalid   = core_ivalid;
+            assign core_irdata  = cpu_irdata;
+            assign core_iready  = cpu_iready;
+            assign core_ierror  = cpu_ierror;
+        end
+    endgenerate
+
+    // Fetch path (fe_*: CPU side, fm_*: memory side of the instruction cache).
+    // With ENABLE_HARVARD, the fetch path is the instruction port of the core,
+    // and it has its own bus master. Data accesses go straight to the store
+    // buffer. Otherwise, all accesses use the fetch path.
+    generate
+        if (ENABLE_HARVARD) begin: gen_harvard
+            // native to pipelined protocol: one request per transaction.
+            // Line refills are read using a burst (one answer per word). After
+            // an error, the rest of the burst is dropped: the refill is aborted.
+            // After FENCE.I, wait until the stores are written to memory.
+            localparam IBURST = ENABLE_ICACHE && ICACHE_LINE_WORDS <= 8;
+            reg [3:0] beats;
+            reg       drop, fence_wait;
+            wire      burst;
+            assign burst = IBURST && fm_burst;
+            always @(posedge clk or posedge rst) begin
+                if (rst) begin
+                    beats      <= 0;
+                    drop       <= 0;
+                    fence_wait <= 0;
+                end else begin
+                    if (imaster_valid) begin
+                        // verilator lint_off WIDTH
+                        beats <= burst ? ICACHE_LINE_WORDS : 1;
+                        // verilator lint_on WIDTH
+                        drop  <= 0;
+                    end else if (imaster_ready || imaster_error) begin
+                        beats <= beats - 1;
+                        drop  <= drop || imaster_error;
+                    end
+                    fence_wait <= (fence_wait || cpu_fencei) && !sb_empty;
+                end
+            end
+            assign fe_address      = cpu_iaddress;
+            assign fe_wdata        = 32'b0;
+            assign fe_wsel         = 4'b0;
+            assign fe_valid        = cpu_ivalid;
+            assign fe_fetch        = 1;
+            assign cpu_irdata      = fe_rdata;
+            assign cpu_iready      = fe_ready;
+            assign cpu_ierror      = fe_error;
+            //
+            assign imaster_address = fm_address;
+            // verilator lint_off WIDTH
+            assign imaster_burst   = burst ? ICACHE_LINE_WORDS - 1 : 0;
+            // verilator lint_on WIDTH
+            assign imaster_valid   = fm_valid && beats == 0 && !fence_wait;
+            assign fm_rdata        = imaster_rdata;
+            assign fm_ready        = imaster_ready && !drop;
+            assign fm_error        = imaster_error && !drop;
+            //
+            assign ic_address      = cpu_address;
+            assign ic_wdata        = cpu_wdata;
+            assign ic_wsel         = cpu_wsel;
+            assign ic_valid        = cpu_valid;
+            assign cpu_rdata       = ic_rdata;
+            assign cpu_ready       = ic_ready;
+            assign cpu_error       = ic_error;
+            // unused signals: remove verilator warnings about unused signal
+            wire _unused = &{cpu_fetch, fm_wdata, fm_wsel};
+        end else begin: gen_no_harvard
+            assign fe_address      = cpu_address;
+            assign fe_wdata        = cpu_wdata;
+            assign fe_wsel         = cpu_wsel;
+            assign fe_valid        = cpu_valid;
+            assign fe_fetch        = cpu_fetch;
+            assign cpu_rdata       = fe_rdata;
+            assign cpu_ready       = fe_ready;
+            assign cpu_error       = fe_error;
+            //
+            assign imaster_address = 32'b0;
+            assign imaster_burst   = 3'd0;
+            assign imaster_valid   = 0;
+            //
+            assign ic_address      = fm_address;
+            assign ic_wdata        = fm_wdata;
+            assign ic_wsel         = fm_wsel;
+            assign ic_valid        = fm_valid;
+            assign fm_rdata        = ic_rdata;
+            assign fm_ready        = ic_ready;
+            assign fm_error        = ic_error;
+            assign cpu_irdata      = 32'b0;
+            assign cpu_iready      = 0;
+            assign cpu_ierror      = 0;
+            // unused signals: remove verilator warnings about unused signal
+            wire _unused = &{cpu_iaddress, cpu_ivalid, imaster_rdata, imaster_ready, imaster_error,
+                             fm_burst, sb_empty};
+        end
+    endgenerate
+
+    generate
+        if (ENABLE_ICACHE) begin: gen_icache
+            icache #(// Parameters
+                     .NWAYS      (ICACHE_WAYS),
+                     .NLINES     (ICACHE_LINES),
+                     .LINE_WORDS (ICACHE_LINE_WORDS)
+                     ) icache0 (// Outputs
+                                .cpu_rdata   (fe_rdata[31:0]      ),
+                                .cpu_ready   (fe_ready            ),
+                                .cpu_error   (fe_error            ),
+                                .mem_address (fm_address[31:0]    ),
+                                .mem_wdata   (fm_wdata[31:0]      ),
+                                .mem_wsel    (fm_wsel[3:0]        ),
+                                .mem_valid   (fm_valid            ),
+                                .mem_burst   (fm_burst            ),
+                                // Inputs
+                                .clk         (clk                 ),
+                                .rst         (rst                 ),
+                                .cpu_address (fe_address[31:0]    ),
+                                .cpu_wdata   (fe_wdata[31:0]      ),
+                                .cpu_wsel    (fe_wsel[3:0]        ),
+                                .cpu_valid   (fe_valid            ),
+                                .cpu_fetch   (fe_fetch            ),
+                                .cpu_fencei  (cpu_fencei          ),
+                                .mem_rdata   (fm_rdata[31:0]      ),
+                                .mem_ready   (fm_ready            ),
+                                .mem_error   (fm_error            )
+                                );
+        end else begin: gen_no_icache
+            assign fm_address = fe_address;
+            assign fm_wdata   = fe_wdata;
+            assign fm_wsel    = fe_wsel;
+            assign fm_valid   = fe_valid;
+            assign fm_burst   = 0;
+            assign fe_rdata   = fm_rdata;
+            assign fe_ready   = fm_ready;
+            assign fe_error   = fm_error;
+            // unused signals: remove verilator warnings about unused signal
+            wire _unused = &{fe_fetch, cpu_fencei};
+        end
+    endgenerate
+
+    generate
+        if (ENABLE_STORE_BUF) begin: gen_store_buffer
+            store_buffer #(// Parameters
+                           .DEPTH         (STORE_BUF_DEPTH),
+                           .IO_BASE_ADDR  (32'h2000_0000),
+                           .IO_ADDR_WIDTH (28)
+                           ) store_buffer0 (// Outputs
+                                            .cpu_rdata   (ic_rdata[31:0]      ),
+                                            .cpu_ready   (ic_ready            ),
+                                            .cpu_error   (ic_error            ),
+                                            .mem_address (master_address[31:0]),
+                                            .mem_wdata   (master_wdata[31:0]  ),
+                                            .mem_wsel    (master_wsel[3:0]    ),
+                                            .mem_valid   (master_valid        ),
+                                            .buf_empty   (sb_empty            ),
+                                            // Inputs
+                                            .clk         (clk                 ),
+                                            .rst         (rst                 ),
+                                            .cpu_address (ic_address[31:0]    ),
+                                            .cpu_wdata   (ic_wdata[31:0]      ),
+                                            .cpu_wsel    (ic_wsel[3:0]        ),
+                                            .cpu_valid   (ic_valid            ),
+                                            .cpu_lock    (cpu_lock            ),
+                                            .mem_rdata   (master_rdata[31:0]  ),
+                                            .mem_ready   (master_ready        ),
+                                            .mem_error   (master_error        )
+                                            );
+        end else begin: gen_no_store_buffer
+            // native to pipelined protocol: one request per transaction
+            reg pending;
+            always @(posedge clk or posedge rst) begin
+                if (rst) begin
+                    pending <= 0;
+                end else begin
+                    pending <= (master_valid || pending) && !(master_ready || master_error);
+                end
+            end
+            assign master_address = ic_address;
+            assign master_wdata   = ic_wdata;
+            assign master_wsel    = ic_wsel;
+            assign master_valid   = ic_valid && !pending;
+            assign ic_rdata       = master_rdata;
+            assign ic_ready       = master_ready;
+            assign ic_error       = master_error;
+            assign sb_empty       = 1;
+        end
+    endgenerate
+    // with the store buffer, the lock also covers the stores drained before
+    // the atomic access.
+    assign master_lock = cpu_lock;
+
+    // =====================================================================
+    // unused signals: remove verilator warnings about unused signal
+    wire _unused = &{cfu_valid, cfu_funct, cfu_op1, cfu_op2};
+    // =====================================================================
+endmodule // hart
+`default_nettype wire
+// EOF
@@ -0,0 +1,179 @@
+// -----------------------------------------------------------------------------
+// Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+// -----------------------------------------------------------------------------
+// Title       : Instruction cache
+// Project     : AlgolSoC
+// Description : Direct-mapped/2-way set associative instruction cache.
+//               Instruction fetches are served from the cache (one cycle on
+//               hits), and lines are refilled using the memory bus. Data
+//               accesses are forwarded to the memory bus. Stores invalidate
+//               the matching line, and FENCE.I invalidates the whole cache.
+//               mem_burst flags line refills: the memory side can read the
+//               whole line with a burst, starting at the first word.
+// -----------------------------------------------------------------------------
+
+`default_nettype none
+`timescale 1 ns / 1 ps
+
+module icache #(
+                parameter NWAYS      = 1,  // 1 or 2
+                parameter NLINES     = 64, // lines per way. Power of 2
+                parameter LINE_WORDS = 4   // words per line. Power of 2, >= 2
+                )(
+                  input wire        clk,
+                  input wire        rst,
+                  // CPU port
+                  input wire [31:0] cpu_address,
+                  input wire [31:0] cpu_wdata,
+                  input wire [3:0]  cpu_wsel,
+                  input wire        cpu_valid,
+                  input wire        cpu_fetch,
+                  input wire        cpu_fencei,
+                  output reg [31:0] cpu_rdata,
+                  output reg        cpu_ready,
+                  output reg        cpu_error,
+                  // Memory port
+                  output reg [31:0] mem_address,
+                  output wire [31:0] mem_wdata,
+                  output reg [3:0]  mem_wsel,
+                  output reg        mem_valid,
+                  output wire       mem_burst,  // refill: the line can be read as a burst
+                  input wire [31:0] mem_rdata,
+                  input wire        mem_ready,
+                  input wire        mem_error
+                  );
+    // =====================================================================
+    localparam WOFFW = clog2(LINE_WORDS);
+    localparam IDXW  = clog2(NLINES);
+    localparam TAGW  = 30 - IDXW - WOFFW;
+    localparam NSETS = NWAYS * NLINES;
+    //
+    reg [31:0]         data [0:NSETS*LINE_WORDS-1];
+    reg [TAGW-1:0]     tags [0:NSETS-1];
+    reg [NSETS-1:0]    line_valid;
+    reg [NLINES-1:0]   lru;         // way to replace (2-way)
+    //
+    wire [WOFFW-1:0]   word;
+    wire [IDXW-1:0]    index;
+    wire [TAGW-1:0]    tag;
+    wire [NWAYS-1:0]   way_hit;
+    wire               hit;
+    wire               hit_way;
+    wire               miss;
+    wire               store;
+    wire [31:0]        hit_line, victim_line, refill_line;
+    //
+    reg                refill;
+    reg                refill_way;
+    reg [WOFFW-1:0]    refill_cnt;
+    reg [TAGW-1:0]     refill_tag;
+    reg [IDXW-1:0]     refill_index;
+    //
+    assign word  = cpu_address[WOFFW+1:2];
+    assign index = cpu_address[IDXW+WOFFW+1:WOFFW+2];
+    assign tag   = cpu_address[31:IDXW+WOFFW+2];
+    // tag compare
+    generate
+        genvar w;
+        for (w = 0; w < NWAYS; w = w + 1) begin:tag_cmp
+            assign way_hit[w] = line_valid[w*NLINES + index] && tags[w*NLINES + index] == tag;
+        end
+    endgenerate
+    assign hit     = |way_hit;
+    assign hit_way = NWAYS == 2 ? way_hit[NWAYS-1] : 1'b0;
+    assign miss    = cpu_valid && cpu_fetch && !hit && !refill;
+    assign store   = cpu_valid && !cpu_fetch && |cpu_wsel;
+    // verilator lint_off WIDTH
+    assign hit_line    = hit_way * NLINES + index;
+    assign victim_line = (NWAYS == 2 ? lru[index] : 1'b0) * NLINES + index;
+    assign refill_line = refill_way * NLINES + refill_index;
+    // verilator lint_on WIDTH
+    // CPU port
+    always @(*) begin
+        if (cpu_fetch) begin
+            cpu_rdata = data[{hit_line[IDXW:0], word}];
+            cpu_ready = cpu_valid && hit && !refill;
+            cpu_error = refill && mem_error; // the error could be in other word of the line
+        end else begin
+            cpu_rdata = mem_rdata;
+            cpu_ready = mem_ready;
+            cpu_error = mem_error;
+        end
+    end
+    // Memory port
+    assign mem_wdata = cpu_wdata;
+    assign mem_burst = refill;
+    always @(*) begin
+        if (refill) begin
+            mem_address = {refill_tag, refill_index, refill_cnt, 2'b00};
+            mem_wsel    = 0;
+            mem_valid   = 1;
+        end else begin
+            mem_address = cpu_address;
+            mem_wsel    = cpu_wsel;
+            mem_valid   = cpu_valid && !cpu_fetch;
+        end
+    end
+    // refill
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            refill <= 0;
+        end else begin
+            if (miss) begin
+                refill       <= 1;
+                refill_way   <= NWAYS == 2 ? lru[index] : 1'b0;
+                refill_cnt   <= 0;
+                refill_tag   <= tag;
+                refill_index <= index;
+            end
+            if (refill && mem_ready) begin
+                refill_cnt <= refill_cnt + 1;
+                if (&refill_cnt) refill <= 0;
+            end
+            if (refill && mem_error) refill <= 0;
+        end
+    end
+    always @(posedge clk) begin
+        if (refill && mem_ready)                data[{refill_line[IDXW:0], refill_cnt}] <= mem_rdata;
+        if (refill && mem_ready && &refill_cnt) tags[refill_line]                        <= refill_tag;
+    end
+    // valid bits & replacement
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            line_valid <= 0;
+            lru        <= 0;
+        end else if (cpu_fencei) begin
+            line_valid <= 0;
+        end else begin
+            // line is being replaced
+            if (miss) line_valid[victim_line] <= 0;
+            if (refill && mem_ready && &refill_cnt) begin
+                line_valid[refill_line] <= 1;
+                lru[refill_index]       <= !refill_way;
+            end
+            if (cpu_ready && cpu_fetch) lru[index] <= !hit_way;
+            // snoop stores: self-modifying code
+            if (store) begin: snoop
+                integer i;
+                for (i = 0; i < NWAYS; i = i + 1) begin
+                    if (way_hit[i]) line_valid[i*NLINES + index] <= 0;
+                end
+            end
+        end
+    end
+    // I hate ISE c:
+    function integer clog2;
+        input integer value;
+        begin
+            value = value - 1;
+            for (clog2 = 0; value > 0; clog2 = clog2 + 1)
+              value = value >> 1;
+        end
+    endfunction
+    // =====================================================================
+    // unused signals: remove verilator warnings about unused signal
+    wire _unused = &{cpu_address[1:0], hit_line[31:IDXW+1], refill_line[31:IDXW+1]};
+    // =====================================================================
+endmodule
+`default_nettype wire
+// EOF
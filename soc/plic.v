@@ -0,0 +1,121 @@
+// -----------------------------------------------------------------------------
+// Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+// -----------------------------------------------------------------------------
+// Title       : Interrupt controller
+// Project     : AlgolSoC
+// Description : PLIC-style interrupt controller: one target (machine mode).
+//               Level-triggered sources, with priorities, enable bits, a
+//               priority threshold, and claim/complete.
+// -----------------------------------------------------------------------------
+
+`default_nettype none
+`timescale 1 ns / 1 ps
+
+// Registers (source IDs: 1 to NSOURCES. ID 0: no interrupt):
+// 0x00 + 4*ID: priority of the source. 0: never interrupts.
+// 0x80: pending bits (bit ID). Read-only.
+// 0xC0: enable bits (bit ID).
+// 0xE0: priority threshold. Sources with priority <= threshold are masked.
+// 0xE4: claim (read): ID of the highest priority pending source (lowest ID on
+//       ties), and clears its pending bit. complete (write): ID of the
+//       serviced source. A claimed source does not interrupt until completed.
+module plic #(
+              parameter NSOURCES  = 2, // < 32
+              parameter PRIO_BITS = 3
+              )(
+                input wire                clk,
+                input wire                rst,
+                input wire [31:0]         plic_address,
+                input wire [31:0]         plic_wdata,
+                input wire [ 3:0]         plic_wsel,
+                input wire                plic_valid,
+                output reg [31:0]         plic_rdata,
+                output reg                plic_ready,
+                output reg                plic_error,
+                //
+                input wire [NSOURCES:1]   irq_sources,
+                output wire               xint_meip
+                );
+    // =====================================================================
+    reg [PRIO_BITS-1:0] prio     [1:NSOURCES];
+    reg [NSOURCES:1]    pending, enable, active;
+    reg [PRIO_BITS-1:0] threshold;
+    reg [4:0]           claim_id;
+    reg [PRIO_BITS-1:0] claim_prio;
+    //
+    wire                is_prio, is_pending, is_enable, is_threshold, is_claim;
+    wire                write, claim, complete;
+    wire [5:0]          prio_id;
+    //
+    assign prio_id      = plic_address[7:2];
+    assign is_prio      = plic_address[7] == 1'b0;
+    assign is_pending   = plic_address[7:0] == 8'h80;
+    assign is_enable    = plic_address[7:0] == 8'hC0;
+    assign is_threshold = plic_address[7:0] == 8'hE0;
+    assign is_claim     = plic_address[7:0] == 8'hE4;
+    assign write        = plic_valid && (&plic_wsel);
+    assign claim        = plic_valid && !(|plic_wsel) && is_claim;
+    assign complete     = write && is_claim;
+    // highest priority pending source
+    always @(*) begin: arbiter
+        integer i;
+        claim_id   = 0;
+        claim_prio = threshold;
+        for (i = 1; i <= NSOURCES; i = i + 1) begin
+            if (pending[i] && enable[i] && prio[i] > claim_prio) begin
+                claim_id   = i[4:0];
+                claim_prio = prio[i];
+            end
+        end
+    end
+    assign xint_meip = |claim_id;
+    // gateways & registers
+    always @(posedge clk or posedge rst) begin: control
+        integer i;
+        if (rst) begin
+            pending   <= 0;
+            enable    <= 0;
+            active    <= 0;
+            threshold <= 0;
+            for (i = 1; i <= NSOURCES; i = i + 1) prio[i] <= 0;
+        end else begin
+            for (i = 1; i <= NSOURCES; i = i + 1) begin
+                if (irq_sources[i] && !active[i]) pending[i] <= 1;
+                if (claim && claim_id == i) begin
+                    pending[i] <= 0;
+                    active[i]  <= 1;
+                end
+                if (complete && plic_wdata[4:0] == i) active[i] <= 0;
+                if (write && is_prio && prio_id == i) prio[i] <= plic_wdata[PRIO_BITS-1:0];
+            end
+            if (write && is_enable)    enable    <= plic_wdata[NSOURCES:1];
+            if (write && is_threshold) threshold <= plic_wdata[PRIO_BITS-1:0];
+        end
+    end
+    // read
+    always @(posedge clk) begin
+        (* parallel_case *)
+        case (1'b1)
+            is_prio:      plic_rdata <= (prio_id >= 1 && prio_id <= NSOURCES) ? {{(32-PRIO_BITS){1'b0}}, prio[prio_id[4:0]]} : 32'b0;
+            is_pending:   plic_rdata <= {{(31-NSOURCES){1'b0}}, pending, 1'b0};
+            is_enable:    plic_rdata <= {{(31-NSOURCES){1'b0}}, enable, 1'b0};
+            is_threshold: plic_rdata <= {{(32-PRIO_BITS){1'b0}}, threshold};
+            is_claim:     plic_rdata <= {27'b0, claim_id};
+            default:      plic_rdata <= 32'bx;
+        endcase
+    end
+    // handshake
+    always @(*) begin
+        plic_error = 0;
+    end
+    always @(posedge clk or posedge rst) begin
+        plic_ready <= plic_valid && !(|plic_address[1:0]);
+        if (rst) plic_ready <= 0;
+    end
+    // =====================================================================
+    // unused signals: remove verilator warnings about unused signal
+    wire _unused = &{plic_address, plic_wdata};
+    // =====================================================================
+endmodule
+`default_nettype wire
+// EOF
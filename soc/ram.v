@@ -3,7 +3,7 @@
 // -----------------------------------------------------------------------------
 // Title       : RAM
 // Project     : AlgolSoC
-// Description : System RAM
+// Description : System RAM. True dual-port: two independent read/write ports.
 // -----------------------------------------------------------------------------
 
 `default_nettype none
@@ -20,41 +20,69 @@ module ram #(
                input wire        ram_valid,
                output reg [31:0] ram_rdata,
                output reg        ram_ready,
-               output reg        ram_error
+               output reg        ram_error,
+               // port B
+               input wire [31:0] ram_b_address,
+               input wire [31:0] ram_b_wdata,
+               input wire [ 3:0] ram_b_wsel,
+               input wire        ram_b_valid,
+               output reg [31:0] ram_b_rdata,
+               output reg        ram_b_ready,
+               output reg        ram_b_error
                );
     // =====================================================================
     localparam WORDS = 2**(RAM_AW-2);  // words
     //
     reg [31:0]        mem[0:WORDS-1] /* verilator public */;
     wire [RAM_AW-3:0] d_address;         // words...
+    wire [RAM_AW-3:0] b_address;
     //
     assign d_address = ram_address[RAM_AW-1:2];
+    assign b_address = ram_b_address[RAM_AW-1:2];
     // handshake
     always @(*) begin
-        ram_error = 0;
+        ram_error   = 0;
+        ram_b_error = 0;
     end
+    // A new request can be accepted every cycle. Answer in the next cycle.
     always @(posedge clk or posedge rst) begin
-        ram_ready <= ram_valid && !ram_ready;
-        if (rst) ram_ready <= 0;
+        ram_ready   <= ram_valid;
+        ram_b_ready <= ram_b_valid;
+        if (rst) begin
+            ram_ready   <= 0;
+            ram_b_ready <= 0;
+        end
     end
     // read
     always @(posedge clk) begin
         ram_rdata <= 32'bx;
-        if (ram_valid && !ram_ready) ram_rdata <= mem[d_address];
+        if (ram_valid) ram_rdata <= mem[d_address];
+    end
+    always @(posedge clk) begin
+        ram_b_rdata <= 32'bx;
+        if (ram_b_valid) ram_b_rdata <= mem[b_address];
     end
 
     // write
     always @(posedge clk) begin
-        if (ram_valid && ram_ready) begin
+        if (ram_valid) begin
             if (ram_wsel[0]) mem[d_address][0+:8]  <= ram_wdata[0+:8];
             if (ram_wsel[1]) mem[d_address][8+:8]  <= ram_wdata[8+:8];
             if (ram_wsel[2]) mem[d_address][16+:8] <= ram_wdata[16+:8];
             if (ram_wsel[3]) mem[d_address][24+:8] <= ram_wdata[24+:8];
         end
     end
+    always @(posedge clk) begin
+        if (ram_b_valid) begin
+            if (ram_b_wsel[0]) mem[b_address][0+:8]  <= ram_b_wdata[0+:8];
+            if (ram_b_wsel[1]) mem[b_address][8+:8]  <= ram_b_wdata[8+:8];
+            if (ram_b_wsel[2]) mem[b_address][16+:8] <= ram_b_wdata[16+:8];
+            if (ram_b_wsel[3]) mem[b_address][24+:8] <= ram_b_wdata[24+:8];
+        end
+    end
     // =====================================================================
     // unused signals: remove verilator warnings about unused signal
-    wire _unused = &{ram_address[31:RAM_AW], ram_address[1:0]};
+    wire _unused = &{ram_address[31:RAM_AW], ram_address[1:0], ram_b_address[31:RAM_AW], ram_b_address[1:0]};
     // =====================================================================
 endmodule
 `default_nettype wire
@@ -0,0 +1,265 @@
+// -----------------------------------------------------------------------------
+// Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+// -----------------------------------------------------------------------------
+// Title       : SPI flash
+// Project     : AlgolSoC
+// Description : Execute-in-place (read-only) SPI/QSPI flash controller.
+//               Reads are served from a buffer of two lines (even and odd
+//               lines). A miss reads the whole line from the flash, and the
+//               words are answered as they arrive. After a line is read, the
+//               chip select is kept low: a read of the next line continues
+//               the transfer without a new command. If the CPU uses the line,
+//               the next one is prefetched. QUAD mode uses the quad I/O read
+//               (EBh) in continuous read mode: only the first transfer sends
+//               the command. SCK = clk/2, SPI mode 0.
+//               Writes answer with an error.
+// -----------------------------------------------------------------------------
+
+`default_nettype none
+`timescale 1 ns / 1 ps
+
+module spiflash #(
+                  parameter FLASH_AW   = 24, // <= 24 (3-byte addresses)
+                  parameter LINE_WORDS = 8,  // words per line. Power of 2, >= 2
+                  parameter QUAD       = 1   // 1: quad I/O read (EBh). 0: read (03h)
+                  )(
+                    input wire        clk,
+                    input wire        rst,
+                    input wire [31:0] flash_address,
+                    input wire [31:0] flash_wdata,
+                    input wire [3:0]  flash_wsel,
+                    input wire        flash_valid,
+                    output reg [31:0] flash_rdata,
+                    output reg        flash_ready,
+                    output reg        flash_error,
+                    // SPI
+                    output reg        spi_sck,
+                    output reg        spi_csn,
+                    output reg [3:0]  spi_io_o,
+                    output reg [3:0]  spi_io_oe,
+                    input wire [3:0]  spi_io_i
+                    );
+    // =====================================================================
+    localparam WOFFW   = clog2(LINE_WORDS);
+    localparam LINEW   = FLASH_AW - WOFFW - 2;
+    localparam QDEPTH  = 4;                 // requests in flight (MAX_PENDING of the bus)
+    localparam CMD     = QUAD ? 8'hEB : 8'h03;
+    localparam S_IDLE  = 3'd0;
+    localparam S_CSH   = 3'd1;              // chip select high time
+    localparam S_CMD   = 3'd2;
+    localparam S_ADDR  = 3'd3;
+    localparam S_MODE  = 3'd4;
+    localparam S_DUMMY = 3'd5;
+    localparam S_DATA  = 3'd6;
+    //
+    // request queue
+    reg [31:0]           q_address [0:QDEPTH-1];
+    reg [QDEPTH-1:0]     q_write;
+    reg [2:0]            q_head, q_tail;
+    wire                 q_empty;
+    wire [31:0]          h_address;
+    wire [LINEW-1:0]     h_line;
+    wire [WOFFW-1:0]     h_word;
+    wire                 h_write;
+    // line buffer: slot = line[0]
+    reg [31:0]           buffer [0:2*LINE_WORDS-1];
+    reg [LINEW-1:0]      tag [0:1];
+    reg [LINE_WORDS-1:0] word_valid [0:1];
+    reg [1:0]            touched;
+    wire [1:0]           slot_hit;
+    wire                 hit, h_slot;
+    // transfer
+    reg [2:0]            state;
+    reg [5:0]            count;             // SPI clocks left in the phase
+    reg [31:0]           sr;                // output shift register
+    reg [31:0]           rx;
+    reg                  stream;            // CS low, the flash sends next_line
+    reg                  cont;              // continuous read mode (QUAD)
+    reg [LINEW-1:0]      fill_line, next_line;
+    reg [WOFFW-1:0]      fill_word;
+    wire [23:0]          fill_address;
+    wire [LINEW-1:0]     new_line;
+    wire                 fill_slot, new_slot, filling, miss, prefetch, done;
+    wire                 quad_out;
+    //
+    assign q_empty   = q_head == q_tail;
+    assign h_address = q_address[q_head[1:0]];
+    assign h_write   = q_write[q_head[1:0]];
+    assign h_line    = h_address[FLASH_AW-1:WOFFW+2];
+    assign h_word    = h_address[WOFFW+1:2];
+    assign h_slot    = h_line[0];
+    assign fill_slot = fill_line[0];
+    // verilator lint_off WIDTH
+    assign fill_address = {fill_line, {WOFFW+2{1'b0}}};
+    // verilator lint_on WIDTH
+    // a line being read: the words are valid after they arrive.
+    assign slot_hit[0] = tag[0] == h_line && word_valid[0][h_word];
+    assign slot_hit[1] = tag[1] == h_line && word_valid[1][h_word];
+    assign hit         = !q_empty && !h_write && |slot_hit;
+    assign filling     = state != S_IDLE && fill_line == h_line;
+    assign miss        = !q_empty && !h_write && !(|slot_hit) && !filling;
+    // prefetch the next line if the CPU is using the last one
+    assign prefetch    = stream && touched[fill_slot] && tag[!fill_slot] != next_line;
+    assign new_line    = miss ? h_line : next_line;
+    assign new_slot    = new_line[0];
+    assign done        = spi_sck && count == 1;
+    // =====================================================================
+    // bus port. Answer in order, in the cycle after the request reaches the
+    // head of the queue.
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            q_head      <= 0;
+            q_tail      <= 0;
+            flash_ready <= 0;
+            flash_error <= 0;
+        end else begin
+            flash_ready <= hit;
+            flash_error <= !q_empty && h_write;
+            if (flash_valid) q_tail <= q_tail + 1;
+            if (hit || (!q_empty && h_write)) q_head <= q_head + 1;
+        end
+    end
+    always @(posedge clk) begin
+        if (flash_valid) begin
+            q_address[q_tail[1:0]] <= flash_address;
+            q_write[q_tail[1:0]]   <= |flash_wsel;
+        end
+        flash_rdata <= buffer[{h_slot, h_word}];
+    end
+    // =====================================================================
+    // SPI pins. Single mode: IO2 (WP#) and IO3 (HOLD#) high, IO1 is MISO.
+    // Quad mode: the pins are released while the flash can drive them.
+    assign quad_out = QUAD && (state == S_ADDR || state == S_MODE);
+    always @(*) begin
+        if (quad_out) begin
+            spi_io_o  = sr[31:28];
+            spi_io_oe = 4'b1111;
+        end else if (QUAD && (state == S_DUMMY || state == S_DATA || stream)) begin
+            spi_io_o  = 4'b0000;
+            spi_io_oe = 4'b0000;
+        end else begin
+            spi_io_o  = {2'b11, 1'b0, sr[31]};
+            spi_io_oe = 4'b1101;
+        end
+    end
+    // Each SPI clock takes two cycles: data changes while SCK is low, and it
+    // is sampled at the rising edge. The next phase is loaded at the falling
+    // edge of the last clock.
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            state         <= S_IDLE;
+            spi_sck       <= 0;
+            spi_csn       <= 1;
+            stream        <= 0;
+            cont          <= 0;
+            touched       <= 0;
+            word_valid[0] <= 0;
+            word_valid[1] <= 0;
+        end else begin
+            if (hit) touched[h_slot] <= 1;
+            case (state)
+                S_IDLE: begin
+                    if (miss || prefetch) begin
+                        fill_line            <= new_line;
+                        fill_word            <= 0;
+                        tag[new_slot]        <= new_line;
+                        word_valid[new_slot] <= 0;
+                        touched[new_slot]    <= 0;
+                        if (stream && new_line == next_line) begin
+                            // continue the transfer
+                            state <= S_DATA;
+                            count <= QUAD ? 6'd8 : 6'd32;
+                        end else begin
+                            state   <= S_CSH;
+                            spi_csn <= 1;
+                            stream  <= 0;
+                            count   <= 6'd2;
+                        end
+                    end
+                end
+                S_CSH: begin
+                    count <= count - 1;
+                    if (count == 1) begin
+                        spi_csn <= 0;
+                        if (cont) begin
+                            state <= S_ADDR;
+                            sr    <= {fill_address, 8'b0};
+                            count <= QUAD ? 6'd6 : 6'd24;
+                        end else begin
+                            state <= S_CMD;
+                            sr    <= {CMD, 24'b0};
+                            count <= 6'd8;
+                        end
+                    end
+                end
+                default: begin
+                    spi_sck <= !spi_sck;
+                    if (!spi_sck && state == S_DATA) rx <= QUAD ? {rx[27:0], spi_io_i} : {rx[30:0], spi_io_i[1]};
+                    if (spi_sck) begin
+                        sr    <= quad_out ? sr << 4 : sr << 1;
+                        count <= count - 1;
+                    end
+                    if (done) begin
+                        case (state)
+                            S_CMD: begin
+                                state <= S_ADDR;
+                                sr    <= {fill_address, 8'b0};
+                                count <= QUAD ? 6'd6 : 6'd24;
+                            end
+                            S_ADDR: begin
+                                state <= QUAD ? S_MODE : S_DATA;
+                                sr    <= {8'hA0, 24'b0}; // M[5:4] = 10b: continuous read
+                                count <= QUAD ? 6'd2 : 6'd32;
+                            end
+                            S_MODE: begin
+                                state <= S_DUMMY;
+                                cont  <= 1;
+                                count <= 6'd4;
+                            end
+                            S_DUMMY: begin
+                                state <= S_DATA;
+                                count <= 6'd8;
+                            end
+                            default: begin
+                                // word received
+                                fill_word                        <= fill_word + 1;
+                                word_valid[fill_slot][fill_word] <= 1;
+                                count                            <= QUAD ? 6'd8 : 6'd32;
+                                if (&fill_word) begin
+                                    state     <= S_IDLE;
+                                    stream    <= 1;
+                                    next_line <= fill_line + 1;
+                                end
+                            end
+                        endcase
+                    end
+                    // a different line is needed: abort the transfer
+                    if (state == S_DATA && miss) begin
+                        state   <= S_IDLE;
+                        spi_sck <= 0;
+                        spi_csn <= 1;
+                        stream  <= 0;
+                    end
+                end
+            endcase
+        end
+    end
+    always @(posedge clk) begin
+        if (state == S_DATA && done) buffer[{fill_slot, fill_word}] <= {rx[7:0], rx[15:8], rx[23:16], rx[31:24]};
+    end
+    // I hate ISE c:
+    function integer clog2;
+        input integer value;
+        begin
+            value = value - 1;
+            for (clog2 = 0; value > 0; clog2 = clog2 + 1)
+              value = value >> 1;
+        end
+    endfunction
+    // =====================================================================
+    // unused signals: remove verilator warnings about unused signal
+    wire _unused = &{flash_wdata, h_address[31:FLASH_AW], h_address[1:0]};
+    // =====================================================================
+endmodule
+`default_nettype wire
+// EOF
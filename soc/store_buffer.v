@@ -0,0 +1,191 @@
+// -----------------------------------------------------------------------------
+// Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+// -----------------------------------------------------------------------------
+// Title       : Store buffer
+// Project     : AlgolSoC
+// Description : Posted-write buffer. Stores are acknowledged in the same cycle,
+//               and written to memory when the bus is free. Loads have
+//               priority over buffered stores, and full-word stores are
+//               forwarded to loads. Accesses to the IO region, and locked
+//               accesses (atomics) are not buffered, and wait until the
+//               buffer is empty.
+//               The CPU port uses the native (valid held until ready)
+//               protocol, and the memory port uses the pipelined protocol
+//               of the bus (crossbar): stores are drained back-to-back.
+// -----------------------------------------------------------------------------
+
+`default_nettype none
+`timescale 1 ns / 1 ps
+
+module store_buffer #(
+                      parameter        DEPTH         = 4, // Power of 2, >= 2
+                      parameter [31:0] IO_BASE_ADDR  = 32'h2000_0000,
+                      parameter        IO_ADDR_WIDTH = 28
+                      )(
+                        input wire        clk,
+                        input wire        rst,
+                        // CPU port
+                        input wire [31:0] cpu_address,
+                        input wire [31:0] cpu_wdata,
+                        input wire [3:0]  cpu_wsel,
+                        input wire        cpu_valid,
+                        input wire        cpu_lock,
+                        output reg [31:0] cpu_rdata,
+                        output reg        cpu_ready,
+                        output reg        cpu_error,
+                        // Memory port
+                        output reg [31:0] mem_address,
+                        output reg [31:0] mem_wdata,
+                        output reg [3:0]  mem_wsel,
+                        output reg        mem_valid,
+                        input wire [31:0] mem_rdata,
+                        input wire        mem_ready,
+                        input wire        mem_error,
+                        // all stores written to memory
+                        output wire       buf_empty
+                        );
+    // =====================================================================
+    localparam PTRW = clog2(DEPTH);
+    //
+    reg [31:0]      sb_address [0:DEPTH-1];
+    reg [31:0]      sb_wdata   [0:DEPTH-1];
+    reg [3:0]       sb_wsel    [0:DEPTH-1];
+    reg [DEPTH-1:0] sb_valid;
+    reg [PTRW:0]    head, tail;
+    reg             pend, pend_drain;
+    reg             match, fwd_full;
+    reg [31:0]      fwd_data;
+    //
+    wire            empty, full;
+    wire            is_io, is_write, bypass;
+    wire            resp, bus_free, cpu_wait;
+    wire            cpu_bus, do_drain, push, pop;
+    wire [PTRW-1:0] head_idx, next_idx;
+    wire [PTRW:0]   head_nxt;
+    //
+    assign head_idx = head[PTRW-1:0];
+    assign head_nxt = head + 1;
+    // verilator lint_off WIDTH
+    assign next_idx = head_idx + pop;
+    // verilator lint_on WIDTH
+    assign empty    = head == tail;
+    assign full     = head == {~tail[PTRW], tail[PTRW-1:0]};
+    assign is_io    = cpu_address[31:IO_ADDR_WIDTH] == IO_BASE_ADDR[31:IO_ADDR_WIDTH];
+    assign is_write = |cpu_wsel;
+    assign bypass   = is_io || cpu_lock;
+    // search the newest store to the same word
+    always @(*) begin
+        match    = 0;
+        fwd_full = 0;
+        fwd_data = 32'bx;
+        begin: search
+            integer i;
+            reg [PTRW-1:0] idx;
+            for (i = 0; i < DEPTH; i = i + 1) begin
+                // verilator lint_off WIDTH
+                idx = head_idx + i;
+                // verilator lint_on WIDTH
+                if (sb_valid[idx] && sb_address[idx][31:2] == cpu_address[31:2]) begin
+                    match    = 1;
+                    fwd_full = &sb_wsel[idx];
+                    fwd_data = sb_wdata[idx];
+                end
+            end
+        end
+    end
+    // bus arbitration: the CPU has priority. A new request can be issued in the
+    // cycle the answer of the previous one arrives.
+    // Loads partially overlapping a buffered store wait until the store is drained.
+    assign resp     = pend && (mem_ready || mem_error);
+    assign bus_free = !pend || resp;
+    assign cpu_wait = pend && !pend_drain; // CPU request in flight
+    assign pop      = resp && pend_drain;  // errors are lost: the store was acknowledged
+    assign cpu_bus  = cpu_valid && !cpu_wait && bus_free && (bypass ? empty && !pend : !is_write && !match);
+    assign do_drain = !cpu_bus && bus_free && !empty && !(pop && head_nxt == tail);
+    assign push     = cpu_valid && is_write && !bypass && !full;
+    assign buf_empty = empty; // entries are removed after the answer
+    // CPU port
+    always @(*) begin
+        cpu_rdata = mem_rdata;
+        cpu_ready = 0;
+        cpu_error = 0;
+        (* parallel_case *)
+        case (1'b1)
+            cpu_wait: begin
+                cpu_ready = mem_ready;
+                cpu_error = mem_error;
+            end
+            push: begin
+                cpu_ready = 1;
+            end
+            cpu_valid && !is_write && !bypass && match && fwd_full: begin
+                cpu_rdata = fwd_data;
+                cpu_ready = 1;
+            end
+            default: begin
+            end
+        endcase
+    end
+    // Memory port
+    always @(*) begin
+        if (do_drain) begin
+            mem_address = sb_address[next_idx];
+            mem_wdata   = sb_wdata[next_idx];
+            mem_wsel    = sb_wsel[next_idx];
+            mem_valid   = 1;
+        end else begin
+            mem_address = cpu_address;
+            mem_wdata   = cpu_wdata;
+            mem_wsel    = cpu_wsel;
+            mem_valid   = cpu_bus;
+        end
+    end
+    // FIFO
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            head       <= 0;
+            tail       <= 0;
+            sb_valid   <= 0;
+            pend       <= 0;
+            pend_drain <= 0;
+        end else begin
+            if (bus_free) begin
+                pend       <= cpu_bus || do_drain;
+                pend_drain <= do_drain;
+            end
+            if (push) begin
+                tail                     <= tail + 1;
+                sb_valid[tail[PTRW-1:0]] <= 1;
+            end
+            if (pop) begin
+                head               <= head_nxt;
+                sb_valid[head_idx] <= 0;
+            end
+        end
+    end
+    always @(posedge clk) begin
+        if (push) begin
+            sb_address[tail[PTRW-1:0]] <= cpu_address;
+            sb_wdata[tail[PTRW-1:0]]   <= cpu_wdata;
+            sb_wsel[tail[PTRW-1:0]]    <= cpu_wsel;
+        end
+    end
+    // parameter check: the pointers need at least one index bit
+    generate
+        if (DEPTH < 2 || (DEPTH & (DEPTH - 1)) != 0) begin: gen_depth_error
+            initial $error("store_buffer: DEPTH must be a power of 2, >= 2");
+        end
+    endgenerate
+    // I hate ISE c:
+    function integer clog2;
+        input integer value;
+        begin
+            value = value - 1;
+            for (clog2 = 0; value > 0; clog2 = clog2 + 1)
+              value = value >> 1;
+        end
+    endfunction
+    // =====================================================================
+endmodule
+`default_nettype wire
+// EOF
@@ -0,0 +1,78 @@
+// -----------------------------------------------------------------------------
+// Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+// -----------------------------------------------------------------------------
+// Title       : TCM
+// Project     : AlgolSoC
+// Description : Tightly-coupled memory. Connected to the ports of the core
+//               (native interface), in front of the bus. Port A: data (and
+//               fetches, without ENABLE_HARVARD). Port B: read-only,
+//               instruction port. Answer in the next cycle.
+// -----------------------------------------------------------------------------
+
+`default_nettype none
+`timescale 1 ns / 1 ps
+
+module tcm #(
+             parameter TCM_AW = 12
+             )(
+               input wire        clk,
+               input wire        rst,
+               input wire [31:0] tcm_address,
+               input wire [31:0] tcm_wdata,
+               input wire [ 3:0] tcm_wsel,
+               input wire        tcm_valid,
+               output reg [31:0] tcm_rdata,
+               output reg        tcm_ready,
+               // port B
+               input wire [31:0] tcm_b_address,
+               input wire        tcm_b_valid,
+               output reg [31:0] tcm_b_rdata,
+               output reg        tcm_b_ready
+               );
+    // =====================================================================
+    localparam WORDS = 2**(TCM_AW-2);  // words
+    //
+    reg [31:0]        mem[0:WORDS-1] /* verilator public */;
+    wire [TCM_AW-3:0] d_address;         // words...
+    wire [TCM_AW-3:0] b_address;
+    wire              d_access, b_access;
+    //
+    assign d_address = tcm_address[TCM_AW-1:2];
+    assign b_address = tcm_b_address[TCM_AW-1:2];
+    // native interface: valid is held until ready. One access per request.
+    assign d_access  = tcm_valid && !tcm_ready;
+    assign b_access  = tcm_b_valid && !tcm_b_ready;
+    // handshake
+    always @(posedge clk or posedge rst) begin
+        tcm_ready   <= d_access;
+        tcm_b_ready <= b_access;
+        if (rst) begin
+            tcm_ready   <= 0;
+            tcm_b_ready <= 0;
+        end
+    end
+    // read
+    always @(posedge clk) begin
+        tcm_rdata <= 32'bx;
+        if (d_access) tcm_rdata <= mem[d_address];
+    end
+    always @(posedge clk) begin
+        tcm_b_rdata <= 32'bx;
+        if (b_access) tcm_b_rdata <= mem[b_address];
+    end
+    // write
+    always @(posedge clk) begin
+        if (d_access) begin
+            if (tcm_wsel[0]) mem[d_address][0+:8]  <= tcm_wdata[0+:8];
+            if (tcm_wsel[1]) mem[d_address][8+:8]  <= tcm_wdata[8+:8];
+            if (tcm_wsel[2]) mem[d_address][16+:8] <= tcm_wdata[16+:8];
+            if (tcm_wsel[3]) mem[d_address][24+:8] <= tcm_wdata[24+:8];
+        end
+    end
+    // =====================================================================
+    // unused signals: remove verilator warnings about unused signal
+    wire _unused = &{tcm_address[31:TCM_AW], tcm_address[1:0], tcm_b_address[31:TCM_AW], tcm_b_address[1:0]};
+    // =====================================================================
+endmodule
+`default_nettype wire
+// EOF
@@ -3,47 +3,145 @@
 // -----------------------------------------------------------------------------
 // Title       : Timer
 // Project     : AlgolSoC
-// Description : System timer.
+// Description : System timer (CLINT-style), with periodic auto-reload of
+//               mtimecmp, and a one-shot compare channel. One mtimecmp and
+//               msip per hart (NHARTS).
 // -----------------------------------------------------------------------------
 
 `default_nettype none
 `timescale 1 ns / 1 ps
 
-module timer (
-              input wire        clk,
-              input wire        rst,
-              input wire [31:0] timer_address,
-              input wire [31:0] timer_wdata,
-              input wire [ 3:0] timer_wsel,
-              input wire        timer_valid,
-              output reg [31:0] timer_rdata,
-              output reg        timer_ready,
-              output reg        timer_error,
-              //
-              output reg        xint_mtip
-              );
+// Registers:
+// 0x00: mtimecmp. 0x08: mtime. 0x10: msip (b0: software interrupt).
+// 0x14: period. If not zero, mtimecmp is reloaded with mtimecmp + period when
+//       mtime >= mtimecmp, and the tick flag is set.
+// 0x18: status. b0: tick. b1: one-shot. b2: tick overrun (tick while the tick
+//       flag is set). Write 1 to clear.
+// 0x1C: one-shot control. b0: enable. Cleared when the one-shot flag is set.
+// 0x20: one-shot compare (64-bit). The one-shot flag is set when enabled, and
+//       mtime >= compare.
+// xint_mtip: mtime >= mtimecmp (period is zero), or any flag of the status.
+// The registers above belong to hart 0. Hart h (1 to NHARTS - 1) has a
+// bank at 0x40 + 0x10*(h - 1): 0x0: mtimecmp (64-bit). 0x8: msip.
+// xint_mtip[h]: mtime >= mtimecmp of the hart.
+// xtime: mtime, for the time CSR of the harts.
+module timer #(
+               parameter NHARTS = 1 // 1 to 8
+               )(
+                 input wire               clk,
+                 input wire               rst,
+                 input wire [31:0]        timer_address,
+                 input wire [31:0]        timer_wdata,
+                 input wire [ 3:0]        timer_wsel,
+                 input wire               timer_valid,
+                 output reg [31:0]        timer_rdata,
+                 output reg               timer_ready,
+                 output reg               timer_error,
+                 //
+                 output reg [NHARTS-1:0]  xint_mtip,
+                 output reg [NHARTS-1:0]  xint_msip,
+                 output wire [63:0]       xtime
+                 );
     // =====================================================================
-    reg [63:0] mtimecmp, mtime;
+    reg [63:0] mtimecmp [0:NHARTS-1];
+    reg [63:0] mtime, oscmp;
+    reg [31:0] period;
+    reg        tick, overrun, oneshot, os_enable;
+    wire       write, match, reload, os_match;
+    wire       bank;
+    wire [3:0] hart;
+    //
+    assign write    = timer_valid && (&timer_wsel);
+    assign match    = mtime >= mtimecmp[0];
+    assign reload   = |period && match;
+    assign os_match = os_enable && mtime >= oscmp;
+    assign bank     = |timer_address[7:6];
+    assign hart     = timer_address[7:4] - 4'd3;
+    assign xtime    = mtime;
     // read
     always @(posedge clk) begin
-        case (timer_address[3:2])
-            2'b00: timer_rdata <= mtimecmp[31:0];
-            2'b01: timer_rdata <= mtimecmp[63:32];
-            2'b10: timer_rdata <= mtime[31:0];
-            2'b11: timer_rdata <= mtime[63:32];
-        endcase
+        if (bank) begin
+            // verilator lint_off WIDTH
+            if (hart < NHARTS) begin
+                case (timer_address[3:2])
+                    2'b00:   timer_rdata <= mtimecmp[hart][31:0];
+                    2'b01:   timer_rdata <= mtimecmp[hart][63:32];
+                    2'b10:   timer_rdata <= {31'b0, xint_msip[hart]};
+                    default: timer_rdata <= 32'bx;
+                endcase
+            end else begin
+                timer_rdata <= 32'bx;
+            end
+            // verilator lint_on WIDTH
+        end else begin
+            case (timer_address[5:2])
+                4'b0000: timer_rdata <= mtimecmp[0][31:0];
+                4'b0001: timer_rdata <= mtimecmp[0][63:32];
+                4'b0010: timer_rdata <= mtime[31:0];
+                4'b0011: timer_rdata <= mtime[63:32];
+                4'b0100: timer_rdata <= {31'b0, xint_msip[0]};
+                4'b0101: timer_rdata <= period;
+                4'b0110: timer_rdata <= {29'b0, overrun, oneshot, tick};
+                4'b0111: timer_rdata <= {31'b0, os_enable};
+                4'b1000: timer_rdata <= oscmp[31:0];
+                4'b1001: timer_rdata <= oscmp[63:32];
+                default: timer_rdata <= 32'bx;
+            endcase
+        end
     end
-    // write
+    // write. The auto-reload and the flags have lower priority than writes.
     always @(posedge clk or posedge rst) begin
-        if (timer_valid && timer_ready && (&timer_wsel)) begin
+        if (reload) begin
+            mtimecmp[0] <= mtimecmp[0] + {32'b0, period};
+            tick        <= 1;
+            overrun     <= overrun || tick;
+        end
+        if (os_match) begin
+            oneshot   <= 1;
+            os_enable <= 0;
+        end
+        if (write && bank) begin
+            // verilator lint_off WIDTH
             // verilator lint_off CASEINCOMPLETE
-            case (timer_address[3:2])
-                2'b00: mtimecmp[31:0]  <= timer_wdata;
-                2'b01: mtimecmp[63:32] <= timer_wdata;
+            if (hart < NHARTS) begin
+                case (timer_address[3:2])
+                    2'b00: mtimecmp[hart][31:0]  <= timer_wdata;
+                    2'b01: mtimecmp[hart][63:32] <= timer_wdata;
+                    2'b10: xint_msip[hart]       <= timer_wdata[0];
+                endcase
+            end
+            // verilator lint_on CASEINCOMPLETE
+            // verilator lint_on WIDTH
+        end
+        if (write && !bank) begin
+            // verilator lint_off CASEINCOMPLETE
+            case (timer_address[5:2])
+                4'b0000: mtimecmp[0][31:0]  <= timer_wdata;
+                4'b0001: mtimecmp[0][63:32] <= timer_wdata;
+                4'b0100: xint_msip[0]       <= timer_wdata[0];
+                4'b0101: period             <= timer_wdata;
+                4'b0110: begin
+                    if (timer_wdata[0]) tick    <= 0;
+                    if (timer_wdata[1]) oneshot <= 0;
+                    if (timer_wdata[2]) overrun <= 0;
+                end
+                4'b0111: os_enable          <= timer_wdata[0];
+                4'b1000: oscmp[31:0]        <= timer_wdata;
+                4'b1001: oscmp[63:32]       <= timer_wdata;
             endcase
             // verilator lint_on CASEINCOMPLETE
         end
-        if (rst) mtimecmp <= -1;
+        if (rst) begin: reset
+            integer h;
+            for (h = 0; h < NHARTS; h = h + 1)
+                mtimecmp[h] <= -1;
+            xint_msip <= 0;
+            period    <= 0;
+            tick      <= 0;
+            overrun   <= 0;
+            oneshot   <= 0;
+            os_enable <= 0;
+        end
     end
     // handshake
     always @(*) begin
@@ -58,9 +156,12 @@ module timer (
         mtime <= mtime + 1;
         if (rst) mtime <= 0;
     end
-    // interrupt flag
-    always @(posedge clk) begin
-        xint_mtip <= mtime >= mtimecmp;
+    // interrupt flags
+    always @(posedge clk) begin: flags
+        integer h;
+        xint_mtip[0] <= (!(|period) && match) || tick || oneshot;
+        for (h = 1; h < NHARTS; h = h + 1)
+            xint_mtip[h] <= mtime >= mtimecmp[h];
     end
     // =====================================================================
     // unused signals: remove verilator warnings about unused signal
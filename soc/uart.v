@@ -5,59 +5,125 @@
 // Project     : AlgolSoC
 // Description : Serial Tx/Rx
 //               Adapted from picosoc
+//               Tx and Rx FIFOs, with level interrupts.
 // -----------------------------------------------------------------------------
 
 `default_nettype none
 `timescale 1 ns / 1 ps
 
-module uart (
-             input wire        clk,
-             input wire        rst,
-             input wire [31:0] uart_address,
-             input wire [31:0] uart_wdata,
-             input wire [ 3:0] uart_wsel,
-             input wire        uart_valid,
-             output reg [31:0] uart_rdata,
-             output reg        uart_ready,
-             output reg        uart_error,
-             //
-             input wire        uart_rx,
-             output wire       uart_tx
-             );
+// Registers:
+// 0x00: Clock divider.
+// 0x04: Tx data. Write: push a byte into the Tx FIFO (dropped if full).
+// 0x08: Rx data. Read: pop a byte from the Rx FIFO.
+// 0x0C: Status. b0: Tx FIFO not full. b1: Rx FIFO not empty. b2: Rx overrun
+//       (write to clear). b3: Tx idle (FIFO empty, and last byte sent).
+// 0x10: Interrupt control. b0: Rx enable. b1: Tx enable. b[15:8]: Rx threshold.
+//       b[23:16]: Tx threshold.
+//       Rx interrupt: Rx level >= max(Rx threshold, 1).
+//       Tx interrupt: Tx level <= Tx threshold.
+// 0x14: Levels. b[15:0]: Rx level. b[31:16]: Tx level.
+module uart #(
+              parameter TX_DEPTH = 16, // Power of 2
+              parameter RX_DEPTH = 16  // Power of 2
+              )(
+                input wire        clk,
+                input wire        rst,
+                input wire [31:0] uart_address,
+                input wire [31:0] uart_wdata,
+                input wire [ 3:0] uart_wsel,
+                input wire        uart_valid,
+                output reg [31:0] uart_rdata,
+                output reg        uart_ready,
+                output reg        uart_error,
+                //
+                input wire        uart_rx,
+                output wire       uart_tx,
+                // DMA requests
+                output wire       uart_rx_dreq,  // Rx data available
+                output wire       uart_tx_dreq,  // Tx FIFO not full
+                //
+                output wire       uart_irq
+                );
     // =====================================================================
+    localparam TXW = clog2(TX_DEPTH);
+    localparam RXW = clog2(RX_DEPTH);
+    //
     reg [31:0] clk_cfg;  // 0
-    reg [7:0]  tx_data;  // 4
-    reg [7:0]  rx_data;  // 8
-    reg        tx_done, rx_done; //12, b0, b1
+    reg        rx_overrun;
+    reg        rx_ie, tx_ie;
+    reg [7:0]  rx_thr, tx_thr;
+    // Rx
+    reg [3:0]  rx_state;
+    reg [7:0]  rx_buffer;
+    reg [31:0] rx_div_cnt;
+    reg [1:0]  uart_rx_sync;
+    // Tx
+    reg [3:0]  bitcnt;
+    reg [31:0] tx_div_cnt;
+    reg        init;
     reg [9:0]  tx_pattern;
-    wire       is_clk_cfg, is_tx_data, is_rx_data, is_status;
+    // FIFOs
+    reg [7:0]  tx_fifo [0:TX_DEPTH-1];
+    reg [7:0]  rx_fifo [0:RX_DEPTH-1];
+    reg [TXW:0] tx_head, tx_tail;
+    reg [RXW:0] rx_head, rx_tail;
+    wire [TXW:0] tx_level;
+    wire [RXW:0] rx_level;
+    wire       tx_full, tx_empty, rx_full, rx_empty;
+    wire       tx_push, tx_pop, rx_push, rx_pop;
+    wire       tx_idle;
+    //
+    wire       is_clk_cfg, is_tx_data, is_rx_data, is_status, is_irq_ctrl, is_level;
+    wire       write;
     //
-    assign is_clk_cfg = uart_address[3:0] == 4'b0000;
-    assign is_tx_data = uart_address[3:0] == 4'b0100;
-    assign is_rx_data = uart_address[3:0] == 4'b1000;
-    assign is_status  = uart_address[3:0] == 4'b1100;
+    assign is_clk_cfg  = uart_address[4:0] == 5'b00000;
+    assign is_tx_data  = uart_address[4:0] == 5'b00100;
+    assign is_rx_data  = uart_address[4:0] == 5'b01000;
+    assign is_status   = uart_address[4:0] == 5'b01100;
+    assign is_irq_ctrl = uart_address[4:0] == 5'b10000;
+    assign is_level    = uart_address[4:0] == 5'b10100;
+    assign write       = uart_valid && (&uart_wsel);
+    //
+    assign tx_level = tx_tail - tx_head;
+    assign rx_level = rx_tail - rx_head;
+    assign tx_empty = tx_head == tx_tail;
+    assign rx_empty = rx_head == rx_tail;
+    assign tx_full  = tx_head == {~tx_tail[TXW], tx_tail[TXW-1:0]};
+    assign rx_full  = rx_head == {~rx_tail[RXW], rx_tail[RXW-1:0]};
+    assign tx_push  = write && is_tx_data && !tx_full;
+    assign rx_pop   = uart_valid && !(|uart_wsel) && is_rx_data && !rx_empty;
     // read
     always @(posedge clk) begin
         (* parallel_case *)
         case (1'b1)
-            is_clk_cfg: uart_rdata <= clk_cfg;
-            is_tx_data: uart_rdata <= {24'b0, tx_data};
-            is_rx_data: uart_rdata <= {24'b0, rx_data};
-            is_status:  uart_rdata <= {30'b0, rx_done, tx_done};
-            default:    uart_rdata <= 32'bx;
+            is_clk_cfg:  uart_rdata <= clk_cfg;
+            is_rx_data:  uart_rdata <= {24'b0, rx_fifo[rx_head[RXW-1:0]]};
+            is_status:   uart_rdata <= {28'b0, tx_idle, rx_overrun, !rx_empty, !tx_full};
+            is_irq_ctrl: uart_rdata <= {8'b0, tx_thr, rx_thr, 6'b0, tx_ie, rx_ie};
+            is_level:    uart_rdata <= {{(15-TXW){1'b0}}, tx_level, {(15-RXW){1'b0}}, rx_level};
+            default:     uart_rdata <= 32'bx;
         endcase
     end
     // write
     always @(posedge clk or posedge rst) begin
-        if (uart_valid && uart_ready && (&uart_wsel)) begin
+        if (write) begin
             (* parallel_case *)
             case (1'b1)
                 is_clk_cfg: clk_cfg <= uart_wdata;
-                is_tx_data: tx_data <= uart_wdata[7:0];
+                is_irq_ctrl: begin
+                    rx_ie  <= uart_wdata[0];
+                    tx_ie  <= uart_wdata[1];
+                    rx_thr <= uart_wdata[15:8];
+                    tx_thr <= uart_wdata[23:16];
+                end
             endcase
         end
         if (rst) begin
             clk_cfg <= 1; // Max baudrate
+            rx_ie   <= 0;
+            tx_ie   <= 0;
+            rx_thr  <= 1;
+            tx_thr  <= 0;
         end
     end
     // handshake
@@ -68,24 +134,45 @@ module uart (
         uart_ready <= uart_valid && !(|uart_address[1:0]);
         if (rst) uart_ready <= 0;
     end
+    // interrupt & DMA requests
+    // verilator lint_off WIDTH
+    assign uart_irq     = (rx_ie && !rx_empty && rx_level >= rx_thr) || (tx_ie && tx_level <= tx_thr);
+    // verilator lint_on WIDTH
+    assign uart_rx_dreq = !rx_empty;
+    assign uart_tx_dreq = !tx_full;
+    // FIFOs
+    always @(posedge clk or posedge rst) begin
+        if (rst) begin
+            tx_head <= 0;
+            tx_tail <= 0;
+            rx_head <= 0;
+            rx_tail <= 0;
+        end else begin
+            if (tx_push) tx_tail <= tx_tail + 1;
+            if (tx_pop)  tx_head <= tx_head + 1;
+            if (rx_push) rx_tail <= rx_tail + 1;
+            if (rx_pop)  rx_head <= rx_head + 1;
+        end
+    end
+    always @(posedge clk) begin
+        if (tx_push) tx_fifo[tx_tail[TXW-1:0]] <= uart_wdata[7:0];
+        if (rx_push) rx_fifo[rx_tail[RXW-1:0]] <= rx_buffer;
+    end
     // Rx
-    reg [3:0]  rx_state;
-    reg [7:0]  rx_buffer;
-    reg [31:0] rx_div_cnt;
-    reg [1:0]  uart_rx_sync;
+    assign rx_push = rx_state == 4'd10 && rx_div_cnt > clk_cfg && !rx_full;
 
     always @(posedge clk or posedge rst) begin
         if (rst) begin
             rx_state     <= 0;
             rx_div_cnt   <= 0;
             rx_buffer    <= 0;
-            rx_done      <= 0;
+            rx_overrun   <= 0;
             uart_rx_sync <= -1;
         end else begin
             uart_rx_sync <= {uart_rx, uart_rx_sync[1]};
             rx_div_cnt <= rx_div_cnt + 1;
-            if (uart_ready && uart_valid && |uart_wsel && is_status) begin
-                rx_done <= 0;
+            if (write && is_status) begin
+                rx_overrun <= 0;
             end
             case (rx_state)
                 4'd0: begin
@@ -100,9 +187,8 @@ module uart (
                 end
                 4'd10: begin // STOP bit
                     if (rx_div_cnt > clk_cfg) begin
-                        rx_data  <= rx_buffer;
                         rx_state <= 0;
-                        rx_done  <= 1;
+                        if (rx_full) rx_overrun <= 1;
                     end
                 end
                 default: begin
@@ -116,21 +202,17 @@ module uart (
         end
     end
     // Tx
-    reg [3:0]  bitcnt;
-    reg [31:0] tx_div_cnt;
-    reg        tx_start;
-    reg        init;
     assign uart_tx = tx_pattern[0];
+    assign tx_pop  = !init && bitcnt == 0 && !tx_empty;
+    assign tx_idle = bitcnt == 0 && tx_empty;
 
     always @(posedge clk or posedge rst) begin
         tx_div_cnt <= tx_div_cnt + 1;
-        tx_start <= uart_valid && uart_ready && is_tx_data && (&uart_wsel);
 
         if (rst) begin
             tx_pattern <= -1;
             bitcnt     <= 0;
             tx_div_cnt <= 0;
-            tx_done    <= 0;
             init       <= 1;
         end else begin
             if (init && (bitcnt == 0)) begin
@@ -139,20 +221,27 @@ module uart (
                 tx_div_cnt <= 0;
                 init       <= 0;
             end
-            if (tx_start && (bitcnt == 0)) begin
-                tx_pattern <= {1'b1, tx_data, 1'b0};
+            if (tx_pop) begin
+                tx_pattern <= {1'b1, tx_fifo[tx_head[TXW-1:0]], 1'b0};
                 bitcnt     <= 10;
                 tx_div_cnt <= 0;
-                tx_done    <= 0;
             end
             if (tx_div_cnt > clk_cfg && |bitcnt) begin
                 tx_pattern <= {1'b1, tx_pattern[9:1]};
                 bitcnt     <= bitcnt - 1;
                 tx_div_cnt <= 0;
-                tx_done    <= bitcnt == 1;
             end
         end
     end
+    // I hate ISE c:
+    function integer clog2;
+        input integer value;
+        begin
+            value = value - 1;
+            for (clog2 = 0; value > 0; clog2 = clog2 + 1)
+              value = value >> 1;
+        end
+    endfunction
     // =====================================================================
     // unused signals: remove verilator warnings about unused signal
     wire _unused = &{uart_address};
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+ */
+
+// Test for the atomic instructions (ENABLE_RV32A = 1): each AMO must return
+// the old value and write the result, and SC must fail without a valid
+// reservation, or after a store of another bus master (core testbench:
+// mailbox in the .xint section). The instructions are encoded with .insn: the
+// toolchain does not need the A extension.
+#include <stdio.h>
+#include "riscv.h"
+
+#define AMOADD  0x00
+#define AMOSWAP 0x01
+#define LR      0x02
+#define SC      0x03
+#define AMOXOR  0x04
+#define AMOOR   0x08
+#define AMOAND  0x0C
+#define AMOMIN  0x10
+#define AMOMAX  0x14
+#define AMOMINU 0x18
+#define AMOMAXU 0x1C
+
+#define amo(funct5, addr, b) ({ uint32_t __r; asm volatile (".insn r 0x2F, 2, %3, %0, %1, %2" : "=r"(__r) : "r"(addr), "r"(b), "i"((funct5) << 2) : "memory"); __r; })
+#define lr(addr)             ({ uint32_t __r; asm volatile (".insn r 0x2F, 2, %2, %0, %1, x0" : "=r"(__r) : "r"(addr), "i"(LR << 2) : "memory"); __r; })
+#define sc(addr, b)          amo(SC, addr, b)
+
+typedef struct {
+        const char *name;
+        uint32_t    funct5;
+        uint32_t    a, b, result;
+} amo_test_t;
+
+const amo_test_t amo_tests[] = {
+        {"amoadd",  AMOADD,  0x7fffffff, 0x00000001, 0x80000000},
+        {"amoswap", AMOSWAP, 0x12345678, 0xcafebabe, 0xcafebabe},
+        {"amoxor",  AMOXOR,  0xff00ff00, 0x0ff00ff0, 0xf0f0f0f0},
+        {"amoor",   AMOOR,   0xff00ff00, 0x0ff00ff0, 0xfff0fff0},
+        {"amoand",  AMOAND,  0xff00ff00, 0x0ff00ff0, 0x0f000f00},
+        {"amomin",  AMOMIN,  0x00000001, 0xfffffffe, 0xfffffffe},
+        {"amomax",  AMOMAX,  0x00000001, 0xfffffffe, 0x00000001},
+        {"amominu", AMOMINU, 0x00000001, 0xfffffffe, 0x00000001},
+        {"amomaxu", AMOMAXU, 0x00000001, 0xfffffffe, 0xfffffffe},
+};
+
+volatile uint32_t word, other;
+// [3]: address, [4]: data of a store done by the testbench
+volatile uint32_t xint[5] __attribute__((section(".xint"))) = {0};
+volatile int n_illegal;
+
+uintptr_t illegal_handler(uintptr_t epc, uintptr_t regs[32]){
+        n_illegal++;
+        return epc + 4;
+}
+
+// -----------------------------------------------------------------------------
+// Main
+int main(int argc, char* argv[]) {
+        uint32_t old, r;
+        int nerr = 0;
+
+        printf("\tBegin Atomics Test\n");
+        insert_xhandler(X_ILLEGAL_INSTRUCTION, illegal_handler);
+        n_illegal = 0;
+        word      = 0;
+        amo(AMOADD, &word, 0);
+        if (n_illegal != 0) {
+                printf("\tRV32A not supported\n");
+                return 1;
+        }
+        // AMOs: old value, and result in memory
+        for (unsigned i = 0; i < sizeof(amo_tests)/sizeof(amo_tests[0]); i++) {
+                const amo_test_t *t = &amo_tests[i];
+                word = t->a;
+                switch (t->funct5) {
+                case AMOADD:  old = amo(AMOADD,  &word, t->b); break;
+                case AMOSWAP: old = amo(AMOSWAP, &word, t->b); break;
+                case AMOXOR:  old = amo(AMOXOR,  &word, t->b); break;
+                case AMOOR:   old = amo(AMOOR,   &word, t->b); break;
+                case AMOAND:  old = amo(AMOAND,  &word, t->b); break;
+                case AMOMIN:  old = amo(AMOMIN,  &word, t->b); break;
+                case AMOMAX:  old = amo(AMOMAX,  &word, t->b); break;
+                case AMOMINU: old = amo(AMOMINU, &word, t->b); break;
+                default:      old = amo(AMOMAXU, &word, t->b); break;
+                }
+                printf("\t%-8s: %08lx/%08lx\n", t->name, old, word);
+                if (old != t->a || word != t->result)
+                        nerr++;
+        }
+        // LR/SC: success writes and returns 0
+        word = 10;
+        old  = lr(&word);
+        r    = sc(&word, old + 1);
+        printf("\tlr/sc: %lu, %lu -> %lu\n", r, old, word);
+        if (old != 10 || r != 0 || word != 11)
+                nerr++;
+        // SC without reservation (consumed by the last SC): fails
+        r = sc(&word, 20);
+        printf("\tsc (no reservation): %lu -> %lu\n", r, word);
+        if (r != 1 || word != 11)
+                nerr++;
+        // SC after a trap: fails
+        old = lr(&word);
+        asm volatile (".word 0");
+        r = sc(&word, 30);
+        printf("\tsc (trap): %lu -> %lu\n", r, word);
+        if (r != 1 || word != 11 || n_illegal != 1)
+                nerr++;
+        // SC to a different address: fails
+        old = lr(&word);
+        r   = sc(&other, 40);
+        printf("\tsc (address): %lu\n", r);
+        if (r != 1 || other != 0)
+                nerr++;
+        // SC after a store of another master to the reserved word: fails
+        word    = 50;
+        old     = lr(&word);
+        xint[4] = 60;
+        xint[3] = (uintptr_t)&word;
+        while (xint[3]);
+        r = sc(&word, 70);
+        printf("\tsc (store): %lu -> %lu\n", r, word);
+        if (old != 50 || r != 1 || word != 60)
+                nerr++;
+        printf("\tEnd test: %d errors\n", nerr);
+        return nerr;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+ */
+
+// Benchmark for the custom functional unit (ENABLE_CFU = 1), using the sample
+// unit of the core testbench. Each kernel is executed in software and with
+// the custom-0 instructions: the results must match, and the cycles are
+// printed. The instructions are encoded with .insn: the toolchain does not
+// need to know them.
+#include <stdio.h>
+#include "riscv.h"
+
+#define N 256
+
+#define CFU_CRC32      0
+#define CFU_MAC        1
+#define CFU_ACC        2
+#define CFU_INTERLEAVE 3
+
+#define cfu(funct3, a, b) ({ uint32_t __r; asm volatile (".insn r 0x0B, %3, 0, %0, %1, %2" : "=r"(__r) : "r"(a), "r"(b), "i"(funct3)); __r; })
+
+uint8_t data[N];
+int32_t x[N], y[N];
+volatile int n_illegal;
+
+uintptr_t illegal_handler(uintptr_t epc, uintptr_t regs[32]){
+        n_illegal++;
+        return epc + 4;
+}
+
+static inline uint32_t read_cycle() {
+        uint32_t cycle;
+        asm volatile ("csrr %0, mcycle" : "=r"(cycle));
+        return cycle;
+}
+
+// -----------------------------------------------------------------------------
+// software
+static uint32_t crc32_sw(const uint8_t *buf, int n) {
+        uint32_t crc = 0xFFFFFFFF;
+        for (int i = 0; i < n; i++) {
+                crc ^= buf[i];
+                for (int j = 0; j < 8; j++)
+                        crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+        return ~crc;
+}
+
+static int32_t dot_sw(const int32_t *a, const int32_t *b, int n) {
+        int32_t acc = 0;
+        for (int i = 0; i < n; i++)
+                acc += (int32_t)(((int64_t)a[i] * b[i]) >> 16);
+        return acc;
+}
+
+static uint32_t interleave_sw(uint32_t a, uint32_t b) {
+        uint32_t r = 0;
+        for (int i = 0; i < 16; i++)
+                r |= (((a >> i) & 1) << (2*i)) | (((b >> i) & 1) << (2*i + 1));
+        return r;
+}
+
+// -----------------------------------------------------------------------------
+// custom unit
+static uint32_t crc32_cfu(const uint8_t *buf, int n) {
+        uint32_t crc = 0xFFFFFFFF;
+        for (int i = 0; i < n; i++)
+                crc = cfu(CFU_CRC32, crc, buf[i]);
+        return ~crc;
+}
+
+static int32_t dot_cfu(const int32_t *a, const int32_t *b, int n) {
+        int32_t acc = 0;
+        cfu(CFU_ACC, 0, 0);
+        for (int i = 0; i < n; i++)
+                acc = cfu(CFU_MAC, a[i], b[i]);
+        return acc;
+}
+
+// -----------------------------------------------------------------------------
+// Main
+int main(int argc, char* argv[]) {
+        uint32_t sw, hw, c0, c1, c2;
+        int nerr = 0;
+
+        printf("\tBegin CFU Benchmark\n");
+        insert_xhandler(X_ILLEGAL_INSTRUCTION, illegal_handler);
+        n_illegal = 0;
+        cfu(CFU_ACC, 0, 0);
+        if (n_illegal != 0) {
+                printf("\tCFU not supported\n");
+                return 1;
+        }
+        // input data
+        for (int i = 0; i < N; i++) {
+                data[i] = i * 7 + 3;
+                x[i]    = (i - N/2) << 14;         // -32.0 .. 31.75
+                y[i]    = (i & 0xF) << 12 | 0x800; // 0.03 .. 0.97
+        }
+        // CRC-32
+        c0 = read_cycle();
+        sw = crc32_sw(data, N);
+        c1 = read_cycle();
+        hw = crc32_cfu(data, N);
+        c2 = read_cycle();
+        printf("\tcrc32: %08lx/%08lx, sw: %lu cycles, cfu: %lu cycles\n", sw, hw, c1 - c0, c2 - c1);
+        if (sw != hw)
+                nerr++;
+        // Q16.16 dot product
+        c0 = read_cycle();
+        sw = dot_sw(x, y, N);
+        c1 = read_cycle();
+        hw = dot_cfu(x, y, N);
+        c2 = read_cycle();
+        printf("\tdot:   %08lx/%08lx, sw: %lu cycles, cfu: %lu cycles\n", sw, hw, c1 - c0, c2 - c1);
+        if (sw != hw)
+                nerr++;
+        // accumulator: write returns the old value
+        if (cfu(CFU_ACC, 0x1234, 0) != hw || cfu(CFU_ACC, 0, 0) != 0x1234)
+                nerr++;
+        // bit interleave
+        c0 = read_cycle();
+        sw = 0;
+        for (int i = 0; i < N; i++)
+                sw ^= interleave_sw(x[i], y[i]);
+        c1 = read_cycle();
+        hw = 0;
+        for (int i = 0; i < N; i++)
+                hw ^= cfu(CFU_INTERLEAVE, x[i], y[i]);
+        c2 = read_cycle();
+        printf("\tmorton: %08lx/%08lx, sw: %lu cycles, cfu: %lu cycles\n", sw, hw, c1 - c0, c2 - c1);
+        if (sw != hw)
+                nerr++;
+        // unknown function: zero
+        if (cfu(7, 1, 1) != 0)
+                nerr++;
+        printf("\tEnd test: %d errors\n", nerr);
+        return nerr;
+}
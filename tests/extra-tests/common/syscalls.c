@@ -21,9 +21,12 @@ static TRAPFUNC _interrupt_handler[MAX_CAUSE];
 static TRAPFUNC _exception_handler[MAX_CAUSE];
 
 // -----------------------------------------------------------------------------
-// for simulation purposes: write to tohost address.
+// for simulation purposes: write to the tohost address of the hart (one
+// .dword per hart).
 void tohost_exit(uintptr_t code) {
-        tohost = (code << 1) | 1;
+        uintptr_t hart;
+        asm volatile ("csrr %0, mhartid" : "=r"(hart));
+        (&tohost)[hart] = (code << 1) | 1;
         while(1);
         __builtin_unreachable();
 }
@@ -147,8 +150,18 @@ int __attribute__((weak)) main(int argc, char* argv[]){
         return -1;
 }
 
+// Harts 1 to N - 1: the return value is the exit code of the hart. The
+// default parks the hart. Only hart 0 can print (syscalls use its tohost).
+int __attribute__((weak)) thread_entry(uintptr_t cid) {
+        while (1)
+                asm volatile ("wfi");
+        return 0;
+}
+
 // configure the call to main()
-void _init() {
+void _init(uintptr_t cid) {
+        if (cid != 0)
+                tohost_exit(thread_entry(cid));
         // set default trap handlers
         int ii;
         for (ii = 0; ii < MAX_CAUSE; ii++) {
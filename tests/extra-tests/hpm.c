@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+ */
+
+// Self-checking test for the performance counters (ENABLE_COUNTERS = 1,
+// HPM_COUNTERS >= 4), mcountinhibit, and the read-only user shadows.
+// The CSRs are accessed by number: the toolchain does not need to know them.
+#include <stdio.h>
+#include "riscv.h"
+
+#define N 16
+
+#define read_csr(csr) ({ uint32_t __v; asm volatile ("csrr %0, " #csr : "=r"(__v)); __v; })
+#define write_csr(csr, v) asm volatile ("csrw " #csr ", %0" :: "r"(v))
+
+#define MCOUNTINHIBIT 0x320
+#define EV_LOADS      2
+#define EV_STORES     3
+#define EV_BRANCHES   4
+#define EV_MUL        7
+
+volatile uint32_t buffer[N];
+volatile uint32_t factor = 3;
+volatile int n_illegal;
+
+uintptr_t illegal_handler(uintptr_t epc, uintptr_t regs[32]){
+        n_illegal++;
+        return epc + 4;
+}
+
+static void workload() {
+        for (int i = 0; i < N; i++)
+                buffer[i] = buffer[i] * factor;
+}
+
+static void clear_counters() {
+        write_csr(0xB03, 0);
+        write_csr(0xB04, 0);
+        write_csr(0xB05, 0);
+        write_csr(0xB06, 0);
+}
+
+// -----------------------------------------------------------------------------
+// Main
+int main(int argc, char* argv[]) {
+        uint32_t loads, stores, branches, mul, c0, c1;
+        int nerr = 0;
+
+        printf("\tBegin HPM Test\n");
+        insert_xhandler(X_ILLEGAL_INSTRUCTION, illegal_handler);
+        write_csr(0x323, EV_LOADS);
+        write_csr(0x324, EV_STORES);
+        write_csr(0x325, EV_BRANCHES);
+        write_csr(0x326, EV_MUL);
+        // count events
+        clear_counters();
+        workload();
+        loads    = read_csr(0xB03);
+        stores   = read_csr(0xB04);
+        branches = read_csr(0xB05);
+        mul      = read_csr(0xB06);
+        printf("\tloads: %lu, stores: %lu, branches: %lu, mul cycles: %lu\n", loads, stores, branches, mul);
+        if (loads < N || stores < N || branches < N - 1 || mul < N)
+                nerr++;
+        // user shadows: same counters
+        if (read_csr(0xC03) < loads || read_csr(0xC04) < stores)
+                nerr++;
+        // inhibit the loads counter
+        write_csr(MCOUNTINHIBIT, 1 << 3);
+        c0 = read_csr(0xB03);
+        workload();
+        if (read_csr(0xB03) != c0)
+                nerr++;
+        write_csr(MCOUNTINHIBIT, 0);
+        // cycle and time shadows
+        c0 = read_csr(0xC00);
+        c1 = read_csr(0xC01);
+        if (c1 <= c0 || read_csr(0xC02) == 0)
+                nerr++;
+        // unimplemented counter: read-only zero
+        write_csr(0xB1F, 1);
+        if (read_csr(0xB1F) != 0 || read_csr(0x33F) != 0)
+                nerr++;
+        // the shadows are read-only
+        n_illegal = 0;
+        write_csr(0xC00, 0);
+        write_csr(0xC83, 0);
+        if (n_illegal != 2)
+                nerr++;
+        printf("\tEnd test: %d errors\n", nerr);
+        return nerr;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+ */
+
+// Interrupt entry latency, in cycles, using direct (mtvec.MODE = 0) and
+// vectored (mtvec.MODE = 1, ENABLE_VECTORED = 1) modes.
+// Latency: from the store that triggers the software interrupt, to the first
+// instruction of the handler.
+#include <stdio.h>
+#include "riscv.h"
+
+#define NRUNS 4
+
+volatile uint32_t trigg_si[3] __attribute__((section(".xint"))) = {0};
+volatile uint32_t t_entry;
+volatile uint32_t n_int;
+
+extern void trap_entry(void);
+extern void vector_table(void);
+
+// Vector table: exceptions and the other interrupts use the common trap entry.
+// The software interrupt handler only saves the registers it uses.
+asm(
+        "       .text\n"
+        "       .align 6\n"
+        "       .globl vector_table\n"
+        "vector_table:\n"
+        "       j trap_entry\n"         // 0: exceptions
+        "       j trap_entry\n"
+        "       j trap_entry\n"
+        "       j msi_vector\n"         // 3: machine software interrupt
+        "       j trap_entry\n"
+        "       j trap_entry\n"
+        "       j trap_entry\n"
+        "       j trap_entry\n"         // 7: machine timer interrupt
+        "       j trap_entry\n"
+        "       j trap_entry\n"
+        "       j trap_entry\n"
+        "       j trap_entry\n"         // 11: machine external interrupt
+        "msi_vector:\n"
+        "       csrw mscratch, t0\n"
+        "       csrr t0, mcycle\n"
+        "       sw   t1, -4(sp)\n"
+        "       la   t1, t_entry\n"
+        "       sw   t0, 0(t1)\n"
+        "       la   t1, trigg_si\n"
+        "       sw   zero, 0(t1)\n"
+        "       la   t1, n_int\n"
+        "       lw   t0, 0(t1)\n"
+        "       addi t0, t0, 1\n"
+        "       sw   t0, 0(t1)\n"
+        "       lw   t1, -4(sp)\n"
+        "       csrr t0, mscratch\n"
+        "       mret\n"
+        );
+
+static inline uint32_t read_cycle() {
+        uint32_t cycle;
+        asm volatile ("csrr %0, mcycle" : "=r"(cycle));
+        return cycle;
+}
+
+static inline void write_mtvec(uintptr_t value) {
+        asm volatile ("csrw mtvec, %0" :: "r"(value));
+}
+
+static inline uintptr_t read_mtvec() {
+        uintptr_t value;
+        asm volatile ("csrr %0, mtvec" : "=r"(value));
+        return value;
+}
+
+// -----------------------------------------------------------------------------
+// direct mode: common trap entry, and C dispatch
+uintptr_t si_handler(uintptr_t epc, uintptr_t regs[32]){
+        t_entry     = read_cycle();
+        trigg_si[0] = 0;
+        n_int++;
+        return epc;
+}
+
+// minimum latency of NRUNS interrupts
+static uint32_t measure() {
+        uint32_t best = -1;
+        for (int i = 0; i < NRUNS; i++) {
+                uint32_t start;
+                n_int = 0;
+                start = read_cycle();
+                trigg_si[0] = 1; // trigger interrupt
+                while (n_int == 0);
+                if (t_entry - start < best)
+                        best = t_entry - start;
+        }
+        return best;
+}
+
+// -----------------------------------------------------------------------------
+// Main
+int main(int argc, char* argv[]) {
+        uint32_t direct, vectored;
+        int nerr = 0;
+        /*
+         * Measure the latency in both modes.
+         * Test is OK if the vectored mode is supported, and faster.
+         */
+        printf("\tBegin Interrupt Latency Test\n");
+        insert_ihandler(I_MACHINE_SW_INT, si_handler);
+        enable_interrupts();
+        enable_si();
+        //
+        direct = measure();
+        printf("\tDirect mode:   %lu cycles\n", direct);
+        write_mtvec((uintptr_t)vector_table | 1);
+        if ((read_mtvec() & 0x3) != 1) {
+                printf("\tVectored mode not supported\n");
+                nerr++;
+        } else {
+                vectored = measure();
+                printf("\tVectored mode: %lu cycles\n", vectored);
+                if (vectored >= direct)
+                        nerr++;
+        }
+        write_mtvec((uintptr_t)trap_entry);
+        //
+        disable_si();
+        disable_interrupts();
+        printf("\tEnd test\n");
+        return nerr;
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+ */
+
+// Test for the misaligned loads and stores (ENABLE_MISALIGNED = 1):
+// lh/lhu/lw/sh/sw at offsets 1 and 3 (inside a word, and across a word
+// boundary), and a bus error in the second transaction of a split access
+// (the last word of the RAM of the core testbench): access fault with the
+// address of the access in mtval, and the first transaction already done.
+#include <stdio.h>
+#include "riscv.h"
+
+#define read_csr(csr) ({ uint32_t __v; asm volatile ("csrr %0, " #csr : "=r"(__v)); __v; })
+
+#define load(op, addr)     ({ uint32_t __r = 0xdeadbeef; asm volatile (op " %0, 0(%1)" : "+r"(__r) : "r"(addr) : "memory"); __r; })
+#define store(op, addr, v) asm volatile (op " %1, 0(%0)" :: "r"(addr), "r"(v) : "memory")
+
+#define RAM_LAST 0x80FFFFFCu  // last word of the RAM (MEMSZ = 16 MB)
+
+volatile uint8_t buffer[16] __attribute__((aligned(8)));
+volatile uint32_t trap_cause, trap_tval;
+volatile int n_traps;
+
+uintptr_t fault_handler(uintptr_t epc, uintptr_t regs[32]){
+        n_traps++;
+        trap_cause = read_csr(mcause);
+        trap_tval  = read_csr(mtval);
+        return epc + 4;
+}
+
+static void init_buffer() {
+        for (int i = 0; i < 16; i++)
+                buffer[i] = 0x81 + 0x23*i;
+}
+
+// little-endian value of size bytes at buffer + offset
+static uint32_t ref_load(int offset, int size, int sign) {
+        uint32_t v = 0;
+        for (int i = size - 1; i >= 0; i--)
+                v = (v << 8) | buffer[offset + i];
+        if (sign && size == 2 && (v & 0x8000))
+                v |= 0xffff0000;
+        return v;
+}
+
+// compare the buffer with the pattern, with the store of size bytes of v
+static int check_store(int offset, int size, uint32_t v) {
+        for (int i = 0; i < 16; i++) {
+                uint8_t expected = (uint8_t)(0x81 + 0x23*i);
+                if (i >= offset && i < offset + size)
+                        expected = v >> (8*(i - offset));
+                if (buffer[i] != expected)
+                        return 1;
+        }
+        return 0;
+}
+
+// -----------------------------------------------------------------------------
+// Main
+int main(int argc, char* argv[]) {
+        const int offsets[2] = {1, 3};
+        uint32_t r, ref;
+        int nerr = 0;
+
+        printf("\tBegin Misaligned Test\n");
+        insert_xhandler(X_LOAD_ADDRESS_MISA, fault_handler);
+        insert_xhandler(X_STORE_ADDRESS_MISA, fault_handler);
+        insert_xhandler(X_LOAD_ACCESS_FAULT, fault_handler);
+        insert_xhandler(X_STORE_ACCESS_FAULT, fault_handler);
+        n_traps = 0;
+        init_buffer();
+        for (int k = 0; k < 2; k++) {
+                const int off = offsets[k];
+                volatile uint8_t *p = buffer + 4 + off;
+                // loads
+                r = load("lh", p);  ref = ref_load(4 + off, 2, 1);
+                printf("\tlh  +%d: %08lx/%08lx\n", off, r, ref);
+                if (r != ref) nerr++;
+                r = load("lhu", p); ref = ref_load(4 + off, 2, 0);
+                printf("\tlhu +%d: %08lx/%08lx\n", off, r, ref);
+                if (r != ref) nerr++;
+                r = load("lw", p);  ref = ref_load(4 + off, 4, 0);
+                printf("\tlw  +%d: %08lx/%08lx\n", off, r, ref);
+                if (r != ref) nerr++;
+                // stores
+                store("sh", p, 0xcafebabe);
+                printf("\tsh  +%d\n", off);
+                if (check_store(4 + off, 2, 0xcafebabe)) nerr++;
+                init_buffer();
+                store("sw", p, 0x12345678);
+                printf("\tsw  +%d\n", off);
+                if (check_store(4 + off, 4, 0x12345678)) nerr++;
+                init_buffer();
+        }
+        if (n_traps != 0) {
+                printf("\tunexpected traps: %d\n", n_traps);
+                nerr++;
+        }
+        // bus error in the second transaction (RAM_LAST + 4: unmapped)
+        store("sw", RAM_LAST, 0);
+        r = load("lw", RAM_LAST + 2);
+        printf("\tlw (fault): %08lx, cause %lu, mtval %08lx\n", r, trap_cause, trap_tval);
+        if (n_traps != 1 || trap_cause != X_LOAD_ACCESS_FAULT || trap_tval != RAM_LAST + 2 || r != 0xdeadbeef)
+                nerr++;
+        store("sw", RAM_LAST + 1, 0xa1b2c3d4);
+        r = load("lw", RAM_LAST);
+        printf("\tsw (fault): cause %lu, mtval %08lx, first word %08lx\n", trap_cause, trap_tval, r);
+        if (n_traps != 2 || trap_cause != X_STORE_ACCESS_FAULT || trap_tval != RAM_LAST + 1 || r != 0xb2c3d400)
+                nerr++;
+        printf("\tEnd test: %d errors\n", nerr);
+        return nerr;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+ */
+
+// Test for the compressed instructions (ENABLE_RV32C = 1, built with
+// -march=rv32imc): 32-bit instructions that cross a word boundary, compressed
+// branches and jumps to halfword addresses, and the trap state of a compressed
+// instruction (mepc bit 1, and mtval with the 16-bit encoding).
+// The labels at halfword addresses are placed with .balign 4 + c.nop.
+#include <stdio.h>
+#include "riscv.h"
+
+#define read_csr(csr) ({ uint32_t __v; asm volatile ("csrr %0, " #csr : "=r"(__v)); __v; })
+
+volatile uint32_t trap_epc, trap_tval;
+volatile int n_illegal;
+
+uintptr_t illegal_handler(uintptr_t epc, uintptr_t regs[32]){
+        n_illegal++;
+        trap_epc  = epc;
+        trap_tval = read_csr(mtval);
+        return epc + ((trap_tval & 3) == 3 ? 4 : 2);
+}
+
+// 32-bit instructions in the upper half of a word: in sequence, and as the
+// target of a jump (empty realignment buffer). The c.addi must be skipped.
+static uint32_t straddle(uint32_t a) {
+        asm volatile (".option push\n"
+                      ".option norelax\n"
+                      ".option rvc\n"
+                      ".balign 4\n"
+                      "c.nop\n"
+                      ".option norvc\n"
+                      "addi   %0, %0, 1\n"
+                      "addi   %0, %0, 2\n"
+                      ".option rvc\n"
+                      "c.j    1f\n"
+                      ".balign 4\n"
+                      "c.addi %0, 16\n"
+                      ".option norvc\n"
+                      "1:\n"
+                      "addi   %0, %0, 4\n"
+                      "addi   %0, %0, 8\n"
+                      ".option pop\n"
+                      : "+r"(a));
+        return a;
+}
+
+// c.bnez/c.beqz with targets at halfword addresses:
+// x != 0: 2 + 4 + 16 + 8 = 30. x == 0: 1 + 8 = 9.
+static uint32_t branch(uint32_t x) {
+        register uint32_t a0 asm("a0") = x;
+        register uint32_t a1 asm("a1");
+        asm volatile (".option push\n"
+                      ".option norelax\n"
+                      ".option rvc\n"
+                      "c.bnez a0, 1f\n"
+                      "c.li   a1, 1\n"
+                      "c.j    2f\n"
+                      ".balign 4\n"
+                      "c.nop\n"
+                      "1:\n"
+                      "c.li   a1, 2\n"
+                      "c.addi a1, 4\n"
+                      "2:\n"
+                      "c.beqz a0, 3f\n"
+                      ".balign 4\n"
+                      "c.addi a1, 16\n"
+                      "3:\n"
+                      "c.addi a1, 8\n"
+                      ".option pop\n"
+                      : "=r"(a1) : "r"(a0));
+        return a1;
+}
+
+// c.jal and c.jalr to halfword addresses, return with c.jr: 1 + 2 = 3.
+static uint32_t call() {
+        register uint32_t a0 asm("a0");
+        asm volatile (".option push\n"
+                      ".option norelax\n"
+                      ".option rvc\n"
+                      "c.li   a0, 0\n"
+                      "c.jal  1f\n"
+                      "la     a1, 2f\n"
+                      "c.jalr a1\n"
+                      "c.j    3f\n"
+                      ".balign 4\n"
+                      "c.nop\n"
+                      "1:\n"
+                      "c.addi a0, 1\n"
+                      "c.jr   ra\n"
+                      ".balign 4\n"
+                      "c.nop\n"
+                      "2:\n"
+                      "c.addi a0, 2\n"
+                      "c.jr   ra\n"
+                      "3:\n"
+                      ".option pop\n"
+                      : "=r"(a0) : : "a1", "ra");
+        return a0;
+}
+
+// Illegal compressed instruction (c.lwsp x0: reserved) at a halfword
+// address. Returns its address.
+static uint32_t illegal() {
+        uint32_t addr;
+        asm volatile (".option push\n"
+                      ".option norelax\n"
+                      ".option rvc\n"
+                      ".balign 4\n"
+                      "c.nop\n"
+                      "1:\n"
+                      ".half 0x4002\n"
+                      "la     %0, 1b\n"
+                      ".option pop\n"
+                      : "=r"(addr));
+        return addr;
+}
+
+// -----------------------------------------------------------------------------
+// Main
+int main(int argc, char* argv[]) {
+        uint32_t r, addr;
+        int nerr = 0;
+
+        printf("\tBegin RVC Test\n");
+        insert_xhandler(X_ILLEGAL_INSTRUCTION, illegal_handler);
+        n_illegal = 0;
+        // 32-bit instructions across a word boundary
+        r = straddle(100);
+        printf("\tstraddle: %lu\n", r);
+        if (r != 115)
+                nerr++;
+        // branches
+        r = branch(1);
+        printf("\tbranch (x != 0): %lu\n", r);
+        if (r != 30)
+                nerr++;
+        r = branch(0);
+        printf("\tbranch (x == 0): %lu\n", r);
+        if (r != 9)
+                nerr++;
+        // jumps
+        r = call();
+        printf("\tcall: %lu\n", r);
+        if (r != 3)
+                nerr++;
+        // trap
+        addr = illegal();
+        printf("\tillegal: mepc %08lx (%08lx), mtval %08lx\n", trap_epc, addr, trap_tval);
+        if (n_illegal != 1 || trap_epc != addr || (trap_epc & 3) != 2 || trap_tval != 0x4002)
+                nerr++;
+        printf("\tEnd test: %d errors\n", nerr);
+        return nerr;
+}
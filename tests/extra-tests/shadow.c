@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+ */
+
+// Self-checking test for the shadow register bank (ENABLE_SHADOW_REGS = 1).
+// The software interrupt handler runs in bank 1, and overwrites registers
+// without saving them: the interrupted code must not see the changes.
+#include <stdio.h>
+#include "riscv.h"
+
+#define MSHADOW 0x7C0
+
+volatile uint32_t trigg_si[3] __attribute__((section(".xint"))) = {0};
+volatile uint32_t n_int;
+volatile uint32_t isr_mshadow;
+
+extern void trap_entry(void);
+extern void vector_table(void);
+
+// Vector table: exceptions and the other interrupts use the common trap entry.
+asm(
+        "       .text\n"
+        "       .align 6\n"
+        "       .globl vector_table\n"
+        "vector_table:\n"
+        "       j trap_entry\n"         // 0: exceptions
+        "       j trap_entry\n"
+        "       j trap_entry\n"
+        "       j msi_vector\n"         // 3: machine software interrupt
+        "       j trap_entry\n"
+        "       j trap_entry\n"
+        "       j trap_entry\n"
+        "       j trap_entry\n"         // 7: machine timer interrupt
+        "       j trap_entry\n"
+        "       j trap_entry\n"
+        "       j trap_entry\n"
+        "       j trap_entry\n"         // 11: machine external interrupt
+        "msi_vector:\n"
+        "       li   a0, -1\n"
+        "       li   a1, -1\n"
+        "       li   a2, -1\n"
+        "       li   a3, -1\n"
+        "       li   a4, -1\n"
+        "       li   a5, -1\n"
+        "       li   a6, -1\n"
+        "       li   a7, -1\n"
+        "       li   t3, -1\n"
+        "       li   t4, -1\n"
+        "       li   t5, -1\n"
+        "       li   t6, -1\n"
+        "       csrr t0, 0x7C0\n"
+        "       la   t1, isr_mshadow\n"
+        "       sw   t0, 0(t1)\n"
+        "       la   t1, trigg_si\n"
+        "       sw   zero, 0(t1)\n"
+        "       la   t1, n_int\n"
+        "       lw   t0, 0(t1)\n"
+        "       addi t0, t0, 1\n"
+        "       sw   t0, 0(t1)\n"
+        "       mret\n"
+        );
+
+static inline uint32_t read_mshadow() {
+        uint32_t value;
+        asm volatile ("csrr %0, 0x7C0" : "=r"(value));
+        return value;
+}
+
+static inline void write_mshadow(uint32_t value) {
+        asm volatile ("csrw 0x7C0, %0" :: "r"(value));
+}
+
+// Load known values, trigger the interrupt, wait for the handler, and sum the
+// registers. Expected: 10 + ... + 17 + 28 + ... + 31 = 226.
+static uint32_t interrupted_sum() {
+        uint32_t sum, tmp;
+        asm volatile ("li   a0, 10\n"
+                      "li   a1, 11\n"
+                      "li   a2, 12\n"
+                      "li   a3, 13\n"
+                      "li   a4, 14\n"
+                      "li   a5, 15\n"
+                      "li   a6, 16\n"
+                      "li   a7, 17\n"
+                      "li   t3, 28\n"
+                      "li   t4, 29\n"
+                      "li   t5, 30\n"
+                      "li   t6, 31\n"
+                      "li   %[tmp], 1\n"
+                      "sw   %[tmp], 0(%[trig])\n"
+                      "1:\n"
+                      "lw   %[tmp], 0(%[n])\n"
+                      "beqz %[tmp], 1b\n"
+                      "add  %[sum], a0, a1\n"
+                      "add  %[sum], %[sum], a2\n"
+                      "add  %[sum], %[sum], a3\n"
+                      "add  %[sum], %[sum], a4\n"
+                      "add  %[sum], %[sum], a5\n"
+                      "add  %[sum], %[sum], a6\n"
+                      "add  %[sum], %[sum], a7\n"
+                      "add  %[sum], %[sum], t3\n"
+                      "add  %[sum], %[sum], t4\n"
+                      "add  %[sum], %[sum], t5\n"
+                      "add  %[sum], %[sum], t6\n"
+                      : [sum] "=&r"(sum), [tmp] "=&r"(tmp)
+                      : [trig] "r"(trigg_si), [n] "r"(&n_int)
+                      : "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7",
+                        "t3", "t4", "t5", "t6", "memory");
+        return sum;
+}
+
+// -----------------------------------------------------------------------------
+// Main
+int main(int argc, char* argv[]) {
+        uint32_t sum;
+        int nerr = 0;
+
+        printf("\tBegin Shadow Register Test\n");
+        write_mshadow(1);
+        if (read_mshadow() != 1) {
+                printf("\tShadow registers not supported\n");
+                return 1;
+        }
+        asm volatile ("csrw mtvec, %0" :: "r"((uintptr_t)vector_table | 1));
+        enable_interrupts();
+        enable_si();
+        //
+        n_int = 0;
+        sum   = interrupted_sum();
+        printf("\tsum: %lu, mshadow in handler: %lx\n", sum, isr_mshadow);
+        if (sum != 226 || n_int != 1)
+                nerr++;
+        if (isr_mshadow != 0x3 || read_mshadow() != 1) // handler: bank 1, previous 0
+                nerr++;
+        //
+        disable_si();
+        disable_interrupts();
+        asm volatile ("csrw mtvec, %0" :: "r"((uintptr_t)trap_entry));
+        write_mshadow(0);
+        printf("\tEnd test: %d errors\n", nerr);
+        return nerr;
+}
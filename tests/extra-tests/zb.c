@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+ */
+
+// Self-checking test for the Zba/Zbb extensions (ENABLE_ZB = 1).
+// The instructions are encoded with .insn: the toolchain does not need to
+// support the extensions.
+#include <stdio.h>
+#include "riscv.h"
+
+#define ZB_R(name, f3, f7)                                              \
+        static uint32_t name(uint32_t a, uint32_t b) {                  \
+                uint32_t r;                                             \
+                asm volatile (".insn r 0x33, " #f3 ", " #f7 ", %0, %1, %2" \
+                              : "=r"(r) : "r"(a), "r"(b));              \
+                return r;                                               \
+        }
+
+#define ZB_I(name, f3, imm)                                             \
+        static uint32_t name(uint32_t a) {                              \
+                uint32_t r;                                             \
+                asm volatile (".insn i 0x13, " #f3 ", %0, %1, " #imm    \
+                              : "=r"(r) : "r"(a));                      \
+                return r;                                               \
+        }
+
+ZB_R(sh1add, 2, 0x10)
+ZB_R(sh2add, 4, 0x10)
+ZB_R(sh3add, 6, 0x10)
+ZB_R(andn,   7, 0x20)
+ZB_R(orn,    6, 0x20)
+ZB_R(xnor,   4, 0x20)
+ZB_R(max,    6, 0x05)
+ZB_R(maxu,   7, 0x05)
+ZB_R(min,    4, 0x05)
+ZB_R(minu,   5, 0x05)
+ZB_R(rol,    1, 0x30)
+ZB_R(ror,    5, 0x30)
+ZB_I(clz,    1, 0x600)
+ZB_I(ctz,    1, 0x601)
+ZB_I(cpop,   1, 0x602)
+ZB_I(sextb,  1, 0x604)
+ZB_I(sexth,  1, 0x605)
+ZB_I(rori7,  5, 0x607)
+ZB_I(orcb,   5, 0x287)
+ZB_I(rev8,   5, 0x698)
+
+static uint32_t zexth(uint32_t a) {
+        uint32_t r;
+        asm volatile (".insn r 0x33, 4, 0x04, %0, %1, x0" : "=r"(r) : "r"(a));
+        return r;
+}
+
+// -----------------------------------------------------------------------------
+// reference model
+static uint32_t ref_clz(uint32_t a) {
+        uint32_t n = 0;
+        for (int i = 31; i >= 0 && !((a >> i) & 1); i--) n++;
+        return n;
+}
+
+static uint32_t ref_ctz(uint32_t a) {
+        uint32_t n = 0;
+        for (int i = 0; i < 32 && !((a >> i) & 1); i++) n++;
+        return n;
+}
+
+static uint32_t ref_cpop(uint32_t a) {
+        uint32_t n = 0;
+        for (int i = 0; i < 32; i++) n += (a >> i) & 1;
+        return n;
+}
+
+static uint32_t ref_ror(uint32_t a, uint32_t s) {
+        s &= 31;
+        return s ? (a >> s) | (a << (32 - s)) : a;
+}
+
+static uint32_t ref_orcb(uint32_t a) {
+        uint32_t r = 0;
+        for (int i = 0; i < 32; i += 8)
+                if ((a >> i) & 0xff) r |= 0xffu << i;
+        return r;
+}
+
+static uint32_t ref_rev8(uint32_t a) {
+        return (a >> 24) | ((a >> 8) & 0xff00) | ((a << 8) & 0xff0000) | (a << 24);
+}
+
+// -----------------------------------------------------------------------------
+static int nerr;
+
+static void check(const char *name, uint32_t a, uint32_t b, uint32_t result, uint32_t expected) {
+        if (result != expected) {
+                printf("\t%s(0x%08lx, 0x%08lx): 0x%08lx, expected 0x%08lx\n", name, a, b, result, expected);
+                nerr++;
+        }
+}
+
+static void test(uint32_t a, uint32_t b) {
+        int32_t sa = (int32_t)a, sb = (int32_t)b;
+        check("sh1add", a, b, sh1add(a, b), (a << 1) + b);
+        check("sh2add", a, b, sh2add(a, b), (a << 2) + b);
+        check("sh3add", a, b, sh3add(a, b), (a << 3) + b);
+        check("andn",   a, b, andn(a, b),   a & ~b);
+        check("orn",    a, b, orn(a, b),    a | ~b);
+        check("xnor",   a, b, xnor(a, b),   ~(a ^ b));
+        check("max",    a, b, max(a, b),    sa > sb ? a : b);
+        check("maxu",   a, b, maxu(a, b),   a > b ? a : b);
+        check("min",    a, b, min(a, b),    sa < sb ? a : b);
+        check("minu",   a, b, minu(a, b),   a < b ? a : b);
+        check("rol",    a, b, rol(a, b),    ref_ror(a, 32 - (b & 31)));
+        check("ror",    a, b, ror(a, b),    ref_ror(a, b));
+        check("rori",   a, 7, rori7(a),     ref_ror(a, 7));
+        check("clz",    a, 0, clz(a),       ref_clz(a));
+        check("ctz",    a, 0, ctz(a),       ref_ctz(a));
+        check("cpop",   a, 0, cpop(a),      ref_cpop(a));
+        check("sext.b", a, 0, sextb(a),     (uint32_t)(int32_t)(int8_t)a);
+        check("sext.h", a, 0, sexth(a),     (uint32_t)(int32_t)(int16_t)a);
+        check("zext.h", a, 0, zexth(a),     a & 0xffff);
+        check("orc.b",  a, 0, orcb(a),      ref_orcb(a));
+        check("rev8",   a, 0, rev8(a),      ref_rev8(a));
+}
+
+// -----------------------------------------------------------------------------
+// Main
+int main(int argc, char* argv[]) {
+        static const uint32_t values[] = {0x00000000, 0x00000001, 0x80000000, 0xffffffff,
+                                          0x7fffffff, 0x00ff00f0, 0x12345678, 0xfedcba98};
+        const int nvalues = sizeof(values)/sizeof(values[0]);
+        uint32_t seed = 0xace1u;
+        /*
+         * Compare each instruction against a C model.
+         * Test is OK if nerr == 0.
+         */
+        printf("\tBegin Zba/Zbb Test\n");
+        nerr = 0;
+        for (int i = 0; i < nvalues; i++)
+                for (int j = 0; j < nvalues; j++)
+                        test(values[i], values[j]);
+        for (int i = 0; i < 256; i++) {
+                uint32_t a, b;
+                seed = seed * 1664525u + 1013904223u;
+                a    = seed;
+                seed = seed * 1664525u + 1013904223u;
+                b    = seed;
+                test(a, b);
+        }
+        printf("\tEnd test\n");
+        return nerr;
+}
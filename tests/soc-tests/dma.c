@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+ */
+
+// SoC test for the DMA controller (ENABLE_DMA = 1):
+// 1-2: copy from a source that is not 16-byte aligned (chunks of less than 4
+//      words), and a fill.
+// 3-4: copies to and from an unmapped address: the fault bit.
+// 5-6: completion interrupt, through the interrupt controller (source 2).
+// 7-8: AMOs and LR/SC on the RAM while a fill is running (the crossbar holds
+//      the DMA during the locked accesses), and SC after a DMA write to the
+//      reserved word (fails).
+// main returns 0, or the number of the failed check.
+#include <stdint.h>
+
+#define REG(addr)      (*(volatile uint32_t *)(addr))
+#define DMA_SRC        REG(0x20020000u)
+#define DMA_DST        REG(0x20020004u)
+#define DMA_COUNT      REG(0x20020008u)
+#define DMA_CTRL       REG(0x2002000Cu)
+#define DMA_STATUS     REG(0x20020010u)
+#define PLIC_PRIO(id)  REG(0x20030000u + 4*(id))
+#define PLIC_ENABLE    REG(0x200300C0u)
+#define PLIC_THRESHOLD REG(0x200300E0u)
+#define PLIC_CLAIM     REG(0x200300E4u)
+
+#define CTRL_START     0x1
+#define CTRL_COPY      (0 << 1)
+#define CTRL_FILL      (1 << 1)
+#define CTRL_IE        0x8
+#define STATUS_BUSY    0x1
+#define STATUS_DONE    0x2
+#define STATUS_ERROR   0x4
+#define IRQ_DMA        2
+#define UNMAPPED       0x50000000u
+#define FILL           0xA5C3F00Du
+
+#define read_csr(csr)     ({ uint32_t __v; asm volatile ("csrr %0, " #csr : "=r"(__v)); __v; })
+#define set_csr(csr, v)   asm volatile ("csrs " #csr ", %0" :: "r"(v))
+#define clear_csr(csr, v) asm volatile ("csrc " #csr ", %0" :: "r"(v))
+
+#define N    32
+#define NBIG 1024
+
+static uint32_t src[N] __attribute__((aligned(16)));
+static uint32_t dst[N] __attribute__((aligned(16)));
+static uint32_t big[NBIG];
+static volatile uint32_t counter, word;
+static volatile uint32_t irq_id, n_irq, bad_trap;
+
+uintptr_t trap_handler(uintptr_t cause, uintptr_t epc) {
+        if (cause == 0x8000000Bu) {
+                irq_id     = PLIC_CLAIM;
+                DMA_STATUS = STATUS_DONE;  // clear the source
+                PLIC_CLAIM = irq_id;       // complete
+                n_irq++;
+                return epc;
+        }
+        bad_trap = cause;
+        return epc + 4;
+}
+
+static void dma_start(uint32_t s, void *d, uint32_t count, uint32_t ctrl) {
+        DMA_SRC   = s;
+        DMA_DST   = (uintptr_t)d;
+        DMA_COUNT = count;
+        DMA_CTRL  = ctrl | CTRL_START;
+}
+
+// wait until the end of the transfer, clear the flags, and return them
+static uint32_t dma_wait() {
+        uint32_t status;
+        while ((status = DMA_STATUS) & STATUS_BUSY)
+                ;
+        DMA_STATUS = STATUS_DONE | STATUS_ERROR;
+        return status;
+}
+
+static uint32_t lr(volatile uint32_t *addr) {
+        uint32_t r;
+        asm volatile ("lr.w %0, (%1)" : "=r"(r) : "r"(addr) : "memory");
+        return r;
+}
+
+static uint32_t sc(volatile uint32_t *addr, uint32_t value) {
+        uint32_t r;
+        asm volatile ("sc.w %0, %2, (%1)" : "=r"(r) : "r"(addr), "r"(value) : "memory");
+        return r;
+}
+
+static void amoadd(volatile uint32_t *addr, uint32_t value) {
+        asm volatile ("amoadd.w zero, %1, (%0)" :: "r"(addr), "r"(value) : "memory");
+}
+
+// -----------------------------------------------------------------------------
+// Main
+int main() {
+        uint32_t i, n, status, old;
+
+        for (i = 0; i < N; i++) {
+                src[i] = 0x01010101u * i + 0x10203040u;
+                dst[i] = 0;
+        }
+        // 1: copy 9 words from src + 1 (chunks of 3, 4 and 2 words)
+        dma_start((uintptr_t)&src[1], &dst[0], 9, CTRL_COPY);
+        status = dma_wait();
+        if (status != STATUS_DONE)
+                return 1;
+        for (i = 0; i < 9; i++)
+                if (dst[i] != src[i + 1])
+                        return 1;
+        if (dst[9] != 0)
+                return 1;
+        // 2: fill 13 words from dst + 3
+        dma_start(FILL, &dst[3], 13, CTRL_FILL);
+        status = dma_wait();
+        if (status != STATUS_DONE || dst[2] != src[3] || dst[16] != 0)
+                return 2;
+        for (i = 3; i < 16; i++)
+                if (dst[i] != FILL)
+                        return 2;
+        // 3: copy to an unmapped address
+        dma_start((uintptr_t)&src[0], (void *)UNMAPPED, 4, CTRL_COPY);
+        status = dma_wait();
+        if (status != (STATUS_DONE | STATUS_ERROR) || (DMA_STATUS & (STATUS_DONE | STATUS_ERROR)))
+                return 3;
+        // 4: copy from an unmapped address: nothing is written
+        dma_start(UNMAPPED, &dst[20], 4, CTRL_COPY);
+        status = dma_wait();
+        if (status != (STATUS_DONE | STATUS_ERROR) || dst[20] != 0)
+                return 4;
+        // 5-6: completion interrupt
+        PLIC_PRIO(IRQ_DMA) = 1;
+        PLIC_THRESHOLD     = 0;
+        PLIC_ENABLE        = 1 << IRQ_DMA;
+        set_csr(mie, 1 << 11);     // MEIE
+        set_csr(mstatus, 1 << 3);  // MIE
+        dma_start(FILL, &dst[0], N, CTRL_FILL | CTRL_IE);
+        for (i = 0; i < 100000 && n_irq == 0; i++)
+                ;
+        if (n_irq != 1 || irq_id != IRQ_DMA)
+                return 5;
+        if ((DMA_STATUS & (STATUS_BUSY | STATUS_DONE)) || (read_csr(mip) & (1 << 11)) || dst[N - 1] != FILL)
+                return 6;
+        clear_csr(mstatus, 1 << 3);
+        DMA_CTRL = 0;  // interrupt disable
+        // 7: atomics while a fill is running
+        counter = 0;
+        n       = 0;
+        dma_start(FILL, big, NBIG, CTRL_FILL);
+        while (DMA_STATUS & STATUS_BUSY) {
+                amoadd(&counter, 1);
+                do {
+                        old = lr(&counter);
+                } while (sc(&counter, old + 1));
+                n += 2;
+        }
+        status = dma_wait();
+        if (status != STATUS_DONE || n == 0 || counter != n)
+                return 7;
+        for (i = 0; i < NBIG; i++)
+                if (big[i] != FILL)
+                        return 7;
+        // 8: a DMA write to the reserved word clears the reservation
+        word = 1;
+        old  = lr(&word);
+        dma_start(2, (void *)&word, 1, CTRL_FILL);
+        dma_wait();
+        if (old != 1 || sc(&word, 3) != 1 || word != 2)
+                return 8;
+        if (bad_trap)
+                return 9;
+        return 0;
+}
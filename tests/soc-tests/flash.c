@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2018 Angel Terrones <angelterrones@gmail.com>
+ */
+
+// SoC test for the execute-in-place flash (ENABLE_FLASH = 1, flash boot ROM).
+// The code and the constant table are linked at 0x4000_0000
+// (common/flash.ld), the data is in the RAM:
+// 1: sequential reads of the table (line prefetch, continuous read).
+// 2: reads of the table in a scattered order (misses, aborted prefetches).
+// 3: calls to functions on different flash lines, with FENCE.I between the
+//    rounds: the instruction cache refills from the flash each round.
+// main returns 0, or the number of the failed check.
+#include <stdint.h>
+
+#define T(i)   ((uint32_t)(i) * 0x9E3779B9u ^ 0x5A5A0000u)
+#define T4(i)  T(i), T(i + 1), T(i + 2), T(i + 3)
+#define T16(i) T4(i), T4(i + 4), T4(i + 8), T4(i + 12)
+#define N      64
+
+static const uint32_t table[N] = {T16(0), T16(16), T16(32), T16(48)};
+
+// one function per flash line (32 bytes)
+#define LINE __attribute__((noinline, aligned(32)))
+LINE static uint32_t f0(uint32_t x) { return x * 3 + 1; }
+LINE static uint32_t f1(uint32_t x) { return x ^ 0x55aa55aau; }
+LINE static uint32_t f2(uint32_t x) { return (x << 5) | (x >> 27); }
+LINE static uint32_t f3(uint32_t x) { return x - 0x01234567u; }
+
+// -----------------------------------------------------------------------------
+// Main
+int main() {
+        const volatile uint32_t *p = table;
+        uint32_t i, x, y;
+
+        // 1: sequential
+        for (i = 0; i < N; i++)
+                if (p[i] != T(i))
+                        return 1;
+        // 2: scattered (37 is odd: all the entries)
+        for (i = 0; i < N; i++)
+                if (p[(i*37) % N] != T((i*37) % N))
+                        return 2;
+        // 3: code on different lines
+        x = 1;
+        y = 1;
+        for (i = 0; i < 8; i++) {
+                asm volatile ("fence.i" ::: "memory");
+                x = f3(f1(f2(f0(x))));
+                y = y * 3 + 1;
+                y = y ^ 0x55aa55aau;
+                y = (y << 5) | (y >> 27);
+                y = y - 0x01234567u;
+        }
+        if (x != y)
+                return 3;
+        return 0;
+}